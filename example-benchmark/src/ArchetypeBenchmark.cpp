@@ -0,0 +1,90 @@
+//
+//  ArchetypeBenchmark.cpp
+//  example-benchmark
+//
+
+#include "ArchetypeBenchmark.h"
+#include "ofMain.h"
+#include "Benchmark.h"
+#include "mediasystem/core/Scene.h"
+
+using namespace mediasystem;
+
+namespace {
+
+    struct Position {
+        float x{0.f};
+        float y{0.f};
+        float z{0.f};
+    };
+
+    struct Velocity {
+        float x{1.f};
+        float y{2.f};
+        float z{0.f};
+    };
+
+    struct Tint {
+        float r{1.f};
+        float g{1.f};
+        float b{1.f};
+        float a{0.f};
+    };
+
+    constexpr float DT = 1.f / 60.f;
+
+    void runMode(ComponentStorageMode mode, const std::string& name, size_t count, size_t runs){
+        Scene scene(name, mode);
+        if(scene.getStorageMode() != mode){
+            std::printf("  %s storage needs MS_GENERATIONAL_COMPONENT_HANDLES, skipped\n", name.c_str());
+            return;
+        }
+        //every entity also has the ofNode and EntityGraph Scene gives it
+        auto ids = scene.createEntities(count, Position(), Velocity(), Tint());
+        scene.clearQueues();
+
+        report(name + " each, 2 types", count, measure(runs, [&](){
+            scene.view<Position, Velocity>().each([](size_t, Position& position, Velocity& velocity){
+                position.x += velocity.x * DT;
+                position.y += velocity.y * DT;
+                position.z += velocity.z * DT;
+            });
+        }));
+        report(name + " eachChunk, 2 types", count, measure(runs, [&](){
+            scene.view<Position, Velocity>().eachChunk([](size_t rows, const size_t*, Position* positions, Velocity* velocities){
+                for(size_t row = 0; row < rows; ++row){
+                    positions[row].x += velocities[row].x * DT;
+                    positions[row].y += velocities[row].y * DT;
+                    positions[row].z += velocities[row].z * DT;
+                }
+            });
+        }));
+        report(name + " each, 3 types", count, measure(runs, [&](){
+            scene.view<Position, Velocity, Tint>().each([](size_t, Position& position, Velocity& velocity, Tint& tint){
+                position.x += velocity.x * DT;
+                position.y += velocity.y * DT;
+                position.z += velocity.z * DT;
+                tint.a = std::min(tint.a + DT, 1.f);
+            });
+        }));
+        report(name + " eachChunk, 3 types", count, measure(runs, [&](){
+            scene.view<Position, Velocity, Tint>().eachChunk([](size_t rows, const size_t*, Position* positions, Velocity* velocities, Tint* tints){
+                for(size_t row = 0; row < rows; ++row){
+                    positions[row].x += velocities[row].x * DT;
+                    positions[row].y += velocities[row].y * DT;
+                    positions[row].z += velocities[row].z * DT;
+                    tints[row].a = std::min(tints[row].a + DT, 1.f);
+                }
+            });
+        }));
+        consume(scene.getComponents<Position>().get(ids.front())->x);
+    }
+
+}
+
+void runArchetypeBenchmark(size_t count, size_t runs)
+{
+    std::printf("%zu entities with Position, Velocity and Tint\n", count);
+    runMode(ComponentStorageMode::PER_TYPE, "per type", count, runs);
+    runMode(ComponentStorageMode::ARCHETYPE, "archetype", count, runs);
+}
@@ -0,0 +1,13 @@
+//
+//  ArchetypeBenchmark.h
+//  example-benchmark
+//
+
+#pragma once
+
+#include <cstddef>
+
+//Iterates count entities with Position, Velocity and Tint through view().each and view().eachChunk
+//in a per type scene and in an archetype scene, see core/ArchetypeStorage.h. The archetype half
+//needs MS_GENERATIONAL_COMPONENT_HANDLES and is skipped without it.
+void runArchetypeBenchmark(size_t count, size_t runs);
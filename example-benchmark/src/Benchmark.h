@@ -0,0 +1,50 @@
+//
+//  Benchmark.h
+//  example-benchmark
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <algorithm>
+#include "mediasystem/util/BasicTimer.hpp"
+
+//median of runs calls to fn, in milliseconds
+template<typename Fn>
+double measure(size_t runs, Fn&& fn){
+    std::vector<double> times(runs);
+    for(auto & time : times){
+        mediasystem::Timer timer(true);
+        fn();
+        time = timer.getMilliseconds();
+    }
+    std::nth_element(times.begin(), times.begin() + runs / 2, times.end());
+    return times[runs / 2];
+}
+
+//median of runs calls to fn, each after an untimed call to setup
+template<typename Setup, typename Fn>
+double measure(size_t runs, Setup&& setup, Fn&& fn){
+    std::vector<double> times(runs);
+    for(auto & time : times){
+        setup();
+        mediasystem::Timer timer(true);
+        fn();
+        time = timer.getMilliseconds();
+    }
+    std::nth_element(times.begin(), times.begin() + runs / 2, times.end());
+    return times[runs / 2];
+}
+
+//keeps the optimizer from dropping the work being timed
+template<typename T>
+inline void consume(const T& value){
+    static volatile T sink;
+    sink = value;
+}
+
+inline void report(const std::string& name, size_t count, double milliseconds){
+    std::printf("  %-36s %10.3f ms %9.2f ns/component\n", name.c_str(), milliseconds, milliseconds * 1000000.0 / count);
+}
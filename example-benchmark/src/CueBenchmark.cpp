@@ -0,0 +1,146 @@
+//
+//  CueBenchmark.cpp
+//  example-benchmark
+//
+
+#include "CueBenchmark.h"
+#include <list>
+#include <algorithm>
+#include <random>
+#include <functional>
+#include "ofMain.h"
+#include "Benchmark.h"
+#include "mediasystem/core/CueScheduler.h"
+
+using namespace mediasystem;
+
+namespace {
+
+    //the cues of a Scene before the CueScheduler, new cues are staged and every cue is checked each update
+    class ListCues {
+    public:
+
+        CueId add(float executionTime, std::function<void()> handler){
+            auto id = mNextId++;
+            Cue cue;
+            cue.id = id;
+            cue.executionTime = executionTime;
+            cue.handler = std::move(handler);
+            mStagedCues.emplace_back(std::move(cue));
+            return id;
+        }
+
+        void cancel(CueId id){
+            auto found = std::find_if(mCues.begin(), mCues.end(), [id](const Cue& cue){
+                return cue.id == id;
+            });
+            if(found != mCues.end()){
+                mCues.erase(found);
+                return;
+            }
+            found = std::find_if(mStagedCues.begin(), mStagedCues.end(), [id](const Cue& cue){
+                return cue.id == id;
+            });
+            if(found != mStagedCues.end()){
+                mStagedCues.erase(found);
+            }
+        }
+
+        void update(float time){
+            if(!mStagedCues.empty())
+                mCues.splice(mCues.end(), mStagedCues);
+            auto it = mCues.begin();
+            while(it != mCues.end()){
+                if(time >= it->executionTime){
+                    it->handler();
+                    it = mCues.erase(it);
+                }else{
+                    ++it;
+                }
+            }
+        }
+
+        void clear(){
+            mStagedCues.clear();
+            mCues.clear();
+        }
+
+    private:
+
+        struct Cue {
+            CueId id{0};
+            std::function<void()> handler;
+            float executionTime{0.f};
+        };
+
+        std::list<Cue> mStagedCues;
+        std::list<Cue> mCues;
+        CueId mNextId{0};
+    };
+
+    constexpr float DURATION = 6000.f; //100 minutes
+    constexpr float DT = 1.f / 60.f;
+    constexpr size_t FRAMES = 60;
+    constexpr size_t CANCELS = 1000;
+
+}
+
+void runCueBenchmark(size_t count, size_t runs)
+{
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> times(DT * FRAMES * 2.f, DURATION);
+    std::vector<float> executionTimes(count);
+    for(auto & time : executionTimes){
+        time = times(random);
+    }
+    std::vector<size_t> cancelled(std::min(CANCELS, count));
+    std::uniform_int_distribution<size_t> indices(0, count - 1);
+    for(auto & index : cancelled){
+        index = indices(random);
+    }
+
+    size_t ran = 0;
+    auto handler = [&ran](){ ++ran; };
+    CueScheduler scheduler;
+    ListCues list;
+    std::vector<CueId> ids(count);
+    auto fillScheduler = [&](){
+        scheduler.clear();
+        for(size_t i = 0; i < count; ++i){
+            ids[i] = scheduler.add(executionTimes[i], 0.f, false, handler);
+        }
+    };
+    auto fillList = [&](){
+        list.clear();
+        for(size_t i = 0; i < count; ++i){
+            ids[i] = list.add(executionTimes[i], handler);
+        }
+    };
+
+    std::printf("%zu cues over %.0f minutes\n", count, DURATION / 60.f);
+
+    report("list add", count, measure(runs, [&](){ list.clear(); }, [&](){ fillList(); }));
+    report("scheduler add", count, measure(runs, [&](){ scheduler.clear(); }, [&](){ fillScheduler(); }));
+    //a second of frames, nothing is due yet
+    report("list 60 updates", count, measure(runs, fillList, [&](){
+        for(size_t frame = 0; frame < FRAMES; ++frame){
+            list.update(frame * DT);
+        }
+    }));
+    report("scheduler 60 updates", count, measure(runs, fillScheduler, [&](){
+        for(size_t frame = 0; frame < FRAMES; ++frame){
+            scheduler.update(frame * DT);
+        }
+    }));
+    report("list cancel " + std::to_string(cancelled.size()), count, measure(runs, fillList, [&](){
+        for(auto index : cancelled){
+            list.cancel(ids[index]);
+        }
+    }));
+    report("scheduler cancel " + std::to_string(cancelled.size()), count, measure(runs, fillScheduler, [&](){
+        for(auto index : cancelled){
+            scheduler.cancel(ids[index]);
+        }
+    }));
+    consume(ran);
+}
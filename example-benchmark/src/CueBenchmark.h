@@ -0,0 +1,12 @@
+//
+//  CueBenchmark.h
+//  example-benchmark
+//
+
+#pragma once
+
+#include <cstddef>
+
+//Adds, updates and cancels count one shot cues spread over 100 minutes with the CueScheduler and
+//with the two lists a Scene used to scan every update, see core/CueScheduler.h.
+void runCueBenchmark(size_t count, size_t runs);
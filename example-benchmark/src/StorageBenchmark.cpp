@@ -0,0 +1,103 @@
+//
+//  StorageBenchmark.cpp
+//  example-benchmark
+//
+
+#include "StorageBenchmark.h"
+#include <map>
+#include <random>
+#include "ofMain.h"
+#include "Benchmark.h"
+#include "mediasystem/core/Scene.h"
+#include "mediasystem/core/Entity.h"
+
+using namespace mediasystem;
+
+namespace {
+
+    struct Payload {
+        float x{1.f};
+        float y{0.f};
+        float z{0.f};
+        float w{1.f};
+    };
+
+    //the map backend, one per component type keyed by entity id with every component in its own shared handle
+    using MapBackend = std::map<size_t, StrongHandle<void>>;
+
+}
+
+void runStorageBenchmark(size_t count, size_t runs)
+{
+    Scene scene("storage");
+    std::vector<size_t> ids;
+    ids.reserve(count);
+    MapBackend map;
+    for(size_t i = 0; i < count; ++i){
+        auto id = scene.createEntity().lock()->getId();
+        scene.createComponent<Payload>(id);
+        map.emplace(id, makeStrongHandle<Payload>());
+        ids.push_back(id);
+    }
+    //drop the NewEntity and NewComponent events nobody is listening to
+    scene.clearQueues();
+    //lookups in random order, iteration goes through the storage in its own order
+    std::shuffle(ids.begin(), ids.end(), std::mt19937(7));
+
+    std::printf("%zu components\n", count);
+
+    report("map lookup", count, measure(runs, [&](){
+        float sum = 0.f;
+        for(auto id : ids){
+            auto found = map.find(id);
+            sum += staticCast<Payload>(found->second)->x;
+        }
+        consume(sum);
+    }));
+    report("sparse set lookup", count, measure(runs, [&](){
+        auto components = scene.getComponents<Payload>();
+        float sum = 0.f;
+        for(auto id : ids){
+            sum += components.get(id)->x;
+        }
+        consume(sum);
+    }));
+    report("map handle lookup", count, measure(runs, [&](){
+        float sum = 0.f;
+        for(auto id : ids){
+            auto found = map.find(id);
+            Handle<Payload> handle = staticCast<Payload>(found->second);
+            sum += handle.lock()->x;
+        }
+        consume(sum);
+    }));
+    report("sparse set handle lookup", count, measure(runs, [&](){
+        float sum = 0.f;
+        for(auto id : ids){
+            sum += scene.getComponent<Payload>(id).lock()->x;
+        }
+        consume(sum);
+    }));
+    report("map iteration", count, measure(runs, [&](){
+        float sum = 0.f;
+        for(auto & component : map){
+            sum += staticCast<Payload>(component.second)->x;
+        }
+        consume(sum);
+    }));
+    report("sparse set iteration", count, measure(runs, [&](){
+        float sum = 0.f;
+        for(auto & component : scene.getComponents<Payload>()){
+            sum += component.x;
+        }
+        consume(sum);
+    }));
+    report("sparse set handle iteration", count, measure(runs, [&](){
+        auto it = scene.getComponents<Payload>().iter();
+        float sum = 0.f;
+        while(auto component = it.next()){
+            sum += component->x;
+        }
+        consume(sum);
+    }));
+}
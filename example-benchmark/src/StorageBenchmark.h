@@ -0,0 +1,12 @@
+//
+//  StorageBenchmark.h
+//  example-benchmark
+//
+
+#pragma once
+
+#include <cstddef>
+
+//Looks up and iterates count components through Scene's sparse set storage and through the
+//std::map of shared handles per type that Scene used before it, see core/ComponentStorage.h.
+void runStorageBenchmark(size_t count, size_t runs);
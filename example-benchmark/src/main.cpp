@@ -0,0 +1,19 @@
+#include "ofMain.h"
+#include "StorageBenchmark.h"
+#include "ArchetypeBenchmark.h"
+#include "CueBenchmark.h"
+
+//Prints median timings of the component storage, the storage modes and the cues, build in release.
+int main(){
+    ofSetLogLevel(OF_LOG_WARNING);
+    for(size_t count : {1000, 10000, 100000}){
+        runStorageBenchmark(count, 21);
+    }
+    for(size_t count : {1000, 10000, 100000}){
+        runArchetypeBenchmark(count, 21);
+    }
+    for(size_t count : {1000, 10000, 100000}){
+        runCueBenchmark(count, 21);
+    }
+    return 0;
+}
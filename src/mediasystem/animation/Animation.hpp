@@ -9,6 +9,7 @@
 
 #include "mediasystem/core/Scene.h"
 #include "mediasystem/util/Playable.hpp"
+#include "mediasystem/util/TupleHelpers.hpp"
 #include "Easing.hpp"
 #include "ofMain.h"
 
@@ -93,17 +94,35 @@ namespace mediasystem {
             }
         }
         
+        //the queued handler points at the object it was made for, copies bind their own,
+        //ie. components copied by Scene::createEntities or moved between archetype chunks
+        Animatable(const Animatable& other):
+            Playable(other),
+            mStart(other.mStart),
+            mEnd(other.mEnd),
+            mCurrent(other.mCurrent),
+            mTarget(other.mTarget),
+            mEaseFn(other.mEaseFn),
+            mUpdateFn(other.mUpdateFn)
+        {
+            bindUpdateFn();
+        }
+        
+        Animatable(Animatable&& other):
+            Playable(std::move(other)),
+            mStart(std::move(other.mStart)),
+            mEnd(std::move(other.mEnd)),
+            mCurrent(std::move(other.mCurrent)),
+            mTarget(other.mTarget),
+            mEaseFn(std::move(other.mEaseFn)),
+            mUpdateFn(std::move(other.mUpdateFn))
+        {
+            bindUpdateFn();
+        }
+        
         void setUpdateFn(std::function<void()> update) override {
-            Playable::setUpdateFn([&,update](){
-                auto percent = getPercentComplete();
-                if(mEaseFn)
-                    percent = mEaseFn(percent);
-                mCurrent = Tween()(mStart, mEnd, percent);
-                if(mTarget)
-                    *mTarget = mCurrent;
-                if(update)
-                    update();
-            });
+            mUpdateFn = std::move(update);
+            bindUpdateFn();
         }
         
         void animateTo(T end){ mStart = mCurrent; mEnd = std::move(end); play(); }
@@ -118,11 +137,26 @@ namespace mediasystem {
         const T& getEndValue() const { return mEnd; }
 
     private:
+        
+        void bindUpdateFn(){
+            Playable::setUpdateFn([this](){
+                auto percent = getPercentComplete();
+                if(mEaseFn)
+                    percent = mEaseFn(percent);
+                mCurrent = Tween()(mStart, mEnd, percent);
+                if(mTarget)
+                    *mTarget = mCurrent;
+                if(mUpdateFn)
+                    mUpdateFn();
+            });
+        }
+        
         T mStart{0};
         T mEnd{0};
         T mCurrent{0};
         T* mTarget{nullptr};
         EaseFn mEaseFn{nullptr};
+        std::function<void()> mUpdateFn;
     };
 
     using AnimatedFloat = Animatable<float>;
@@ -138,23 +172,30 @@ namespace mediasystem {
 
     using AnimationSystem = AnimationManager<AnimatedFloat,AnimatedVec2,AnimatedVec3,AnimatedVec4,AnimatedQuat,AnimatedRect, AnimatedFloatColor>;
 
+    //Steps the animation components in place, straight off each type's storage, so a destroyed
+    //component is simply gone from the next update without any handle to lock or prune.
+    //Handlers shouldn't destroy their own component, destroy the entity instead, that waits for the end of the update.
     template<typename...AnimationTypes>
     class AnimationManager {
+        
+        using AnimationMaps = std::tuple<ComponentMap<AnimationTypes>...>;
+        
     public:
         
-        AnimationManager(Scene& scene):
-            mScene(scene)
+        //Runs as a scheduled system on the main thread, since update and finish callbacks usually move
+        //entities or trigger events. Pass SystemAccess().onWorkers() to run it on the scheduler's pool when
+        //they only touch the animation components, or whatever else is declared in access.
+        AnimationManager(Scene& scene, SystemAccess access = SystemAccess()):
+            mScene(scene),
+            mAnimationComponents(scene.getComponents<AnimationTypes>()...)
         {
-            bool a[] = {addDelegates<AnimationTypes>()...};
-            (void)a;
-            mScene.addDelegate<Update>(EventDelegate::create<AnimationManager,&AnimationManager::onUpdate>(this));
+            access.write<AnimationTypes...>();
+            mScene.getScheduler().add("AnimationManager", std::move(access), EventDelegate::create<AnimationManager,&AnimationManager::onUpdate>(this));
         }
         
         ~AnimationManager()
         {
-            bool a[] = {removeDelegates<AnimationTypes>()...};
-            (void)a;
-            mScene.removeDelegate<Update>(EventDelegate::create<AnimationManager,&AnimationManager::onUpdate>(this));
+            mScene.getScheduler().remove(EventDelegate::create<AnimationManager,&AnimationManager::onUpdate>(this));
         }
         
         StrongHandle<Animatable<float>> createAnimation(std::string name, float start, float end, float duration, EaseFn easing = nullptr, Animatable<float>::Options opts = Animatable<float>::Options()){
@@ -171,28 +212,17 @@ namespace mediasystem {
         
     private:
         
-        template<typename T>
-        bool addDelegates(){
-            mScene.addDelegate<NewComponent<T>>(EventDelegate::create<AnimationManager,&AnimationManager::onNewAnimation<T>>(this));
-            return true;
-        }
-        
-        template<typename T>
-        bool removeDelegates(){
-            mScene.removeDelegate<NewComponent<T>>(EventDelegate::create<AnimationManager,&AnimationManager::onNewAnimation<T>>(this));
-            return true;
-        }
-        
-        template<typename T>
-        EventStatus onNewAnimation(const IEventRef& event){
-            static_assert(std::is_base_of<Animator,T>::value, "T must derive from Animator, ie be some Animatable<type>");
-            auto newCompEvent = std::static_pointer_cast<NewComponent<T>>(event);
-            auto handle = newCompEvent->getComponentHandle();
-            auto anim = staticCast<Animator>(handle.lock());
-            auto weakGeneric = Handle<Animator>(anim);
-            mAnimationComponents.push_back(weakGeneric);
-            return EventStatus::SUCCESS;
-        }
+        struct AnimationStepper {
+            AnimationStepper(float dt):mDt(dt){}
+            template<typename T>
+            void operator ()(T&& components){
+                for(auto & animator : components){
+                    static_assert(std::is_base_of<Animator,typename std::decay<decltype(animator)>::type>::value, "T must derive from Animator, ie be some Animatable<type>");
+                    animator.step(mDt);
+                }
+            }
+            float mDt{0.f};
+        };
         
         //this should be a synced event maybe
         EventStatus onUpdate(const IEventRef& event){
@@ -210,23 +240,14 @@ namespace mediasystem {
                 }
             }
             
-            auto compIt = mAnimationComponents.begin();
-            auto compEnd = mAnimationComponents.end();
-            while(compIt != compEnd){
-                if(auto animator = compIt->lock()){
-                    animator->step(update->getLastFrameTime());
-                    ++compIt;
-                }else{
-                    compIt = mAnimationComponents.erase(compIt);
-                }
-            }
+            for_each_in_tuple(mAnimationComponents, AnimationStepper(update->getLastFrameTime()));
             
             return EventStatus::SUCCESS;
         }
 
         std::map<std::string,Handle<Animatable<float>>> mAnimations;
-        std::list<Handle<Animator>> mAnimationComponents;
         Scene& mScene;
+        AnimationMaps mAnimationComponents;
     };
 
 }//end namespace mediasystem
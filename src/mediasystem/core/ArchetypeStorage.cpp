@@ -0,0 +1,303 @@
+//
+//  ArchetypeStorage.cpp
+//  ofxMediaSystem
+//
+
+#include "ArchetypeStorage.h"
+
+namespace mediasystem {
+
+    namespace {
+
+        inline size_t alignUp(size_t offset, size_t align){
+            return (offset + align - 1) / align * align;
+        }
+
+    }
+
+    ArchetypeStorage::ArchetypeStorage(AllocationManager* manager):
+        mManager(manager),
+        mLocations(Allocator<Location>(manager))
+    {}
+
+    ArchetypeStorage::~ArchetypeStorage()
+    {
+        clear();
+    }
+
+    size_t ArchetypeStorage::getNumChunks() const
+    {
+        size_t ret = 0;
+        for(auto & archetype : mArchetypes){
+            ret += archetype->chunks.size();
+        }
+        return ret;
+    }
+
+    ComponentStorageMemory ArchetypeStorage::getMemory() const
+    {
+        ComponentStorageMemory memory;
+        for(auto & archetype : mArchetypes){
+            auto rowBytes = sizeof(size_t);
+            for(auto size : archetype->sizes){
+                rowBytes += size;
+            }
+            memory.bytesReserved += archetype->chunks.size() * archetype->chunkBytes;
+            memory.bytesUsed += archetype->count * (rowBytes + sizeof(Location));
+        }
+        memory.bytesReserved += mLocations.capacity() * sizeof(Location);
+        return memory;
+    }
+
+    ArchetypeStorage::Location* ArchetypeStorage::findLocation(size_t entity_id)
+    {
+        auto index = getEntityIndex(entity_id);
+        if(index >= mLocations.size())
+            return nullptr;
+        auto& location = mLocations[index];
+        if(!location.archetype)
+            return nullptr;
+        //the slot may belong to a newer generation of the index
+        auto& chunk = location.archetype->chunks[location.chunk];
+        return location.archetype->getEntityIds(chunk)[location.row] == entity_id ? &location : nullptr;
+    }
+
+    ArchetypeStorage::Archetype* ArchetypeStorage::findArchetype(const ComponentSignature& signature)
+    {
+        //only hit the first time an edge is walked
+        for(auto & archetype : mArchetypes){
+            if(archetype->signature == signature)
+                return archetype.get();
+        }
+
+        auto archetype = new Archetype();
+        archetype->signature = signature;
+        size_t rowBytes = sizeof(size_t);
+        signature.forEach([&](type_index_t type){
+            archetype->types.push_back(type);
+            archetype->sizes.push_back(mColumns[type].size);
+            rowBytes += mColumns[type].size;
+        });
+
+        //fit as many rows as possible into a chunk, alignment padding between columns can cost a few
+        auto capacity = std::max<size_t>(1, CHUNK_BYTES / rowBytes);
+        size_t bytes = 0;
+        while(true){
+            archetype->offsets.clear();
+            bytes = sizeof(size_t) * capacity;
+            for(size_t column = 0; column < archetype->types.size(); ++column){
+                bytes = alignUp(bytes, mColumns[archetype->types[column]].align);
+                archetype->offsets.push_back(bytes);
+                bytes += archetype->sizes[column] * capacity;
+            }
+            if(bytes <= CHUNK_BYTES || capacity == 1)
+                break;
+            --capacity;
+        }
+        archetype->capacity = capacity;
+        archetype->chunkBytes = alignUp(std::max(bytes, CHUNK_BYTES), sizeof(ChunkLine));
+
+        mArchetypes.emplace_back(archetype);
+        return archetype;
+    }
+
+    ArchetypeStorage::Archetype* ArchetypeStorage::getAddEdge(Archetype* from, type_index_t type)
+    {
+        auto& edges = from ? from->addEdges : mRootEdges;
+        auto found = edges.find(type);
+        if(found != edges.end())
+            return found->second;
+        ComponentSignature signature;
+        if(from)
+            signature = from->signature;
+        signature.set(type);
+        auto to = findArchetype(signature);
+        edges.emplace(type, to);
+        if(from)
+            to->removeEdges.emplace(type, from);
+        return to;
+    }
+
+    ArchetypeStorage::Archetype* ArchetypeStorage::getRemoveEdge(Archetype* from, type_index_t type)
+    {
+        auto found = from->removeEdges.find(type);
+        if(found != from->removeEdges.end())
+            return found->second;
+        auto signature = from->signature;
+        signature.reset(type);
+        //removing the last relocatable component leaves the entity without a row
+        auto to = signature.none() ? nullptr : findArchetype(signature);
+        from->removeEdges.emplace(type, to);
+        if(to)
+            to->addEdges.emplace(type, from);
+        return to;
+    }
+
+    ArchetypeStorage::Location ArchetypeStorage::allocateRow(Archetype& archetype, size_t entity_id)
+    {
+        if(archetype.chunks.empty() || archetype.chunks.back().count == archetype.capacity){
+            Allocator<ChunkLine> alloc(mManager);
+            Chunk chunk;
+            chunk.data = reinterpret_cast<unsigned char*>(alloc.allocate(archetype.chunkBytes / sizeof(ChunkLine)));
+            archetype.chunks.push_back(chunk);
+        }
+        auto& chunk = archetype.chunks.back();
+        Location location;
+        location.archetype = &archetype;
+        location.chunk = archetype.chunks.size() - 1;
+        location.row = chunk.count++;
+        archetype.getEntityIds(chunk)[location.row] = entity_id;
+        ++archetype.count;
+        return location;
+    }
+
+    void ArchetypeStorage::freeChunk(Archetype& archetype, Chunk& chunk)
+    {
+        Allocator<ChunkLine> alloc(mManager);
+        alloc.deallocate(reinterpret_cast<ChunkLine*>(chunk.data), archetype.chunkBytes / sizeof(ChunkLine));
+        chunk.data = nullptr;
+        chunk.count = 0;
+    }
+
+    void ArchetypeStorage::eraseRow(Archetype& archetype, size_t chunkIndex, size_t row)
+    {
+        auto& last = archetype.chunks.back();
+        auto lastRow = last.count - 1;
+        auto& chunk = archetype.chunks[chunkIndex];
+        if(&chunk != &last || row != lastRow){
+            auto moved = archetype.getEntityIds(last)[lastRow];
+            archetype.getEntityIds(chunk)[row] = moved;
+            for(size_t column = 0; column < archetype.types.size(); ++column){
+                auto& info = mColumns[archetype.types[column]];
+                auto src = archetype.getComponent(last, column, lastRow);
+                auto dst = archetype.getComponent(chunk, column, row);
+                info.moveConstruct(dst, src);
+                info.destroy(src);
+                info.storage->relocate(moved, dst);
+            }
+            auto& location = mLocations[getEntityIndex(moved)];
+            location.chunk = chunkIndex;
+            location.row = row;
+        }
+        --last.count;
+        --archetype.count;
+        if(last.count == 0){
+            freeChunk(archetype, last);
+            archetype.chunks.pop_back();
+        }
+    }
+
+    void ArchetypeStorage::moveRow(const Location& from, const Location& to, size_t entity_id, type_index_t skip)
+    {
+        auto& src = *from.archetype;
+        auto& dst = *to.archetype;
+        auto& srcChunk = src.chunks[from.chunk];
+        auto& dstChunk = dst.chunks[to.chunk];
+        for(size_t column = 0; column < src.types.size(); ++column){
+            auto type = src.types[column];
+            if(type == skip)
+                continue;
+            auto& info = mColumns[type];
+            auto srcPtr = src.getComponent(srcChunk, column, from.row);
+            auto dstPtr = dst.getComponent(dstChunk, dst.getColumn(type), to.row);
+            info.moveConstruct(dstPtr, srcPtr);
+            info.destroy(srcPtr);
+            info.storage->relocate(entity_id, dstPtr);
+        }
+        eraseRow(src, from.chunk, from.row);
+    }
+
+    void* ArchetypeStorage::insert(type_index_t type, size_t entity_id)
+    {
+        auto index = getEntityIndex(entity_id);
+        if(index >= mLocations.size()){
+            mLocations.resize(index + 1);
+        }
+        Location from;
+        if(auto found = findLocation(entity_id)){
+            from = *found;
+        }
+        auto to = getAddEdge(from.archetype, type);
+        auto location = allocateRow(*to, entity_id);
+        if(from.archetype){
+            moveRow(from, location, entity_id, INVALID_TYPE_INDEX);
+        }
+        mLocations[index] = location;
+        return to->getComponent(to->chunks[location.chunk], to->getColumn(type), location.row);
+    }
+
+    bool ArchetypeStorage::remove(type_index_t type, size_t entity_id)
+    {
+        auto found = findLocation(entity_id);
+        if(!found)
+            return false;
+        auto from = *found;
+        auto column = from.archetype->getColumn(type);
+        if(column == INVALID_COMPONENT_SLOT)
+            return false;
+
+        //park the component outside the chunks, it is destroyed once the entity is consistent again
+        //so a destructor that touches its own entity doesn't see a half moved row
+        auto& info = mColumns[type];
+        std::aligned_storage<256, alignof(std::max_align_t)>::type local;
+        std::unique_ptr<ChunkLine[]> heap;
+        void* parked = &local;
+        if(info.size > sizeof(local)){
+            heap.reset(new ChunkLine[alignUp(info.size, sizeof(ChunkLine)) / sizeof(ChunkLine)]);
+            parked = heap.get();
+        }
+        auto ptr = from.archetype->getComponent(from.archetype->chunks[from.chunk], column, from.row);
+        info.storage->unlinkExternal(entity_id);
+        info.moveConstruct(parked, ptr);
+        info.destroy(ptr);
+
+        auto index = getEntityIndex(entity_id);
+        if(auto to = getRemoveEdge(from.archetype, type)){
+            auto location = allocateRow(*to, entity_id);
+            moveRow(from, location, entity_id, type);
+            mLocations[index] = location;
+        }else{
+            eraseRow(*from.archetype, from.chunk, from.row);
+            mLocations[index] = Location();
+        }
+        info.destroy(parked);
+        return true;
+    }
+
+    void ArchetypeStorage::removeAll(size_t entity_id)
+    {
+        auto found = findLocation(entity_id);
+        if(!found)
+            return;
+        auto location = *found;
+        *found = Location();
+        auto& archetype = *location.archetype;
+        for(size_t column = 0; column < archetype.types.size(); ++column){
+            auto& info = mColumns[archetype.types[column]];
+            info.storage->unlinkExternal(entity_id);
+            info.destroy(archetype.getComponent(archetype.chunks[location.chunk], column, location.row));
+        }
+        eraseRow(archetype, location.chunk, location.row);
+    }
+
+    void ArchetypeStorage::clear()
+    {
+        for(auto & archetype : mArchetypes){
+            for(auto & chunk : archetype->chunks){
+                auto ids = archetype->getEntityIds(chunk);
+                for(size_t row = 0; row < chunk.count; ++row){
+                    for(size_t column = 0; column < archetype->types.size(); ++column){
+                        auto& info = mColumns[archetype->types[column]];
+                        info.storage->unlinkExternal(ids[row]);
+                        info.destroy(archetype->getComponent(chunk, column, row));
+                    }
+                }
+                freeChunk(*archetype, chunk);
+            }
+            archetype->chunks.clear();
+            archetype->count = 0;
+        }
+        mLocations.clear();
+    }
+
+}//end namespace mediasystem
@@ -0,0 +1,169 @@
+//
+//  ArchetypeStorage.h
+//  ofxMediaSystem
+//
+
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <algorithm>
+#include <type_traits>
+#include <unordered_map>
+#include "mediasystem/core/ComponentStorage.h"
+#include "mediasystem/core/ComponentSignature.h"
+
+namespace mediasystem {
+
+    //chosen per scene through the Scene constructor
+    enum class ComponentStorageMode {
+        //one paged sparse set per component type, component addresses never change
+        PER_TYPE,
+        //entities with the same set of components share chunks with one column per type,
+        //components move when their entity gains or loses a component. Needs MS_GENERATIONAL_COMPONENT_HANDLES.
+        ARCHETYPE
+    };
+
+    //Components that may be moved between archetype chunks. Types that hand out their own address
+    //(ie. register `this` as an event delegate) must specialize this to std::false_type,
+    //they stay in per type storage even in archetype scenes.
+    template<typename T>
+    struct is_relocatable_component : std::integral_constant<bool,
+        std::is_move_constructible<T>::value && alignof(T) <= alignof(std::max_align_t)> {};
+
+    //Owns the components of relocatable types in an archetype scene. The per type storages stay
+    //around as the entity -> component index so handles and views keep working, they are
+    //repointed whenever a component moves.
+    class ArchetypeStorage {
+    public:
+
+        static constexpr size_t CHUNK_BYTES = 16 * 1024;
+
+        struct alignas(std::max_align_t) ChunkLine {
+            unsigned char bytes[64];
+        };
+
+        struct Chunk {
+            unsigned char* data{nullptr};
+            size_t count{0};
+        };
+
+        //Every entity with exactly this set of relocatable components. A chunk holds the entity ids
+        //followed by one contiguous column per type, all chunks but the last one are full.
+        struct Archetype {
+            ComponentSignature signature;
+            std::vector<type_index_t> types; //ascending
+            std::vector<size_t> sizes; //parallel to types
+            std::vector<size_t> offsets; //byte offset of each column in a chunk, parallel to types
+            size_t capacity{0}; //rows per chunk
+            size_t chunkBytes{0};
+            size_t count{0};
+            std::vector<Chunk> chunks;
+            std::unordered_map<type_index_t, Archetype*> addEdges;
+            std::unordered_map<type_index_t, Archetype*> removeEdges;
+
+            //INVALID_COMPONENT_SLOT if the archetype doesn't have the type
+            inline size_t getColumn(type_index_t type) const {
+                auto found = std::lower_bound(types.begin(), types.end(), type);
+                return found != types.end() && *found == type ? size_t(found - types.begin()) : INVALID_COMPONENT_SLOT;
+            }
+
+            inline size_t* getEntityIds(const Chunk& chunk) const {
+                return reinterpret_cast<size_t*>(chunk.data);
+            }
+
+            inline void* getColumnData(const Chunk& chunk, size_t column) const {
+                return chunk.data + offsets[column];
+            }
+
+            inline void* getComponent(const Chunk& chunk, size_t column, size_t row) const {
+                return chunk.data + offsets[column] + sizes[column] * row;
+            }
+        };
+
+        explicit ArchetypeStorage(AllocationManager* manager);
+        ~ArchetypeStorage();
+
+        //non copyable
+        ArchetypeStorage(const ArchetypeStorage&) = delete;
+        ArchetypeStorage& operator=(const ArchetypeStorage&) = delete;
+
+        //from here on the storage only indexes components, the objects live in the chunks
+        template<typename T>
+        void registerType(IComponentStorage* storage){
+            static_assert(is_relocatable_component<T>::value, "Only relocatable components can live in archetype chunks.");
+            auto type = type_index<T>();
+            if(type >= mColumns.size()){
+                mColumns.resize(type + 1);
+            }
+            auto& column = mColumns[type];
+            column.size = sizeof(T);
+            column.align = alignof(T);
+            column.moveConstruct = [](void* dst, void* src){ new(dst) T(std::move(*static_cast<T*>(src))); };
+            column.destroy = [](void* ptr){ static_cast<T*>(ptr)->~T(); };
+            column.storage = storage;
+            storage->setExternal();
+        }
+
+        //the entity must not have T yet. T is constructed before the entity moves,
+        //so its constructor can safely look at the entity's other components.
+        template<typename T, typename...Args>
+        T* emplace(size_t entity_id, Args&&...args){
+            T component(std::forward<Args>(args)...);
+            auto type = type_index<T>();
+            auto ptr = insert(type, entity_id);
+            new(ptr) T(std::move(component));
+            mColumns[type].storage->linkExternal(entity_id, ptr);
+            return static_cast<T*>(ptr);
+        }
+
+        bool remove(type_index_t type, size_t entity_id);
+        //destroys all of the entity's relocatable components with a single row removal
+        void removeAll(size_t entity_id);
+        void clear();
+
+        //archetypes are never destroyed, indices stay valid for the life of the scene
+        inline size_t getNumArchetypes() const { return mArchetypes.size(); }
+        inline const Archetype& getArchetype(size_t index) const { return *mArchetypes[index]; }
+        size_t getNumChunks() const;
+        //chunks and the entity locations, objectSize and capacity are left at 0 since rows vary per archetype
+        ComponentStorageMemory getMemory() const;
+
+    private:
+
+        struct ComponentColumn {
+            size_t size{0};
+            size_t align{0};
+            void(*moveConstruct)(void* dst, void* src){nullptr};
+            void(*destroy)(void* ptr){nullptr};
+            IComponentStorage* storage{nullptr};
+        };
+
+        struct Location {
+            Archetype* archetype{nullptr};
+            size_t chunk{0};
+            size_t row{0};
+        };
+
+        //moves the entity to the archetype with type added, returns the uninitialized component
+        void* insert(type_index_t type, size_t entity_id);
+        Archetype* findArchetype(const ComponentSignature& signature);
+        Archetype* getAddEdge(Archetype* from, type_index_t type);
+        Archetype* getRemoveEdge(Archetype* from, type_index_t type);
+        Location allocateRow(Archetype& archetype, size_t entity_id);
+        //moves every component but skip from one row to the other and erases the old row
+        void moveRow(const Location& from, const Location& to, size_t entity_id, type_index_t skip);
+        //fills the hole with the last row, the hole's components must already be moved out or destroyed
+        void eraseRow(Archetype& archetype, size_t chunk, size_t row);
+        void freeChunk(Archetype& archetype, Chunk& chunk);
+        Location* findLocation(size_t entity_id);
+
+        AllocationManager* mManager;
+        std::vector<ComponentColumn> mColumns; //indexed by type_index
+        std::vector<std::unique_ptr<Archetype>> mArchetypes;
+        std::unordered_map<type_index_t, Archetype*> mRootEdges; //single component archetypes
+        std::vector<Location, Allocator<Location>> mLocations; //indexed by entity index
+    };
+
+}//end namespace mediasystem
@@ -0,0 +1,81 @@
+//
+//  CommandBuffer.cpp
+//  ofxMediaSystem
+//
+
+#include "CommandBuffer.h"
+#include "mediasystem/core/Scene.h"
+#include "mediasystem/core/Entity.h"
+
+namespace mediasystem {
+
+    DeferredEntity CommandBuffer::createEntity()
+    {
+        mCommands.push_back(Command{CREATE_ENTITY, mNumEntities, true, nullptr});
+        return DeferredEntity{mNumEntities++};
+    }
+
+    void CommandBuffer::destroyEntity(size_t entity_id)
+    {
+        mCommands.push_back(Command{DESTROY_ENTITY, entity_id, false, nullptr});
+    }
+
+    void CommandBuffer::destroyEntity(DeferredEntity entity)
+    {
+        mCommands.push_back(Command{DESTROY_ENTITY, entity.index, true, nullptr});
+    }
+
+    void CommandBuffer::run(size_t entity_id, std::function<void(Entity&)> fn)
+    {
+        record(entity_id, false, [fn](Scene& scene, size_t id){
+            if(auto entity = scene.getEntity(id).lock())
+                fn(*entity);
+        });
+    }
+
+    void CommandBuffer::run(DeferredEntity entity, std::function<void(Entity&)> fn)
+    {
+        record(entity.index, true, [fn](Scene& scene, size_t id){
+            if(auto entity = scene.getEntity(id).lock())
+                fn(*entity);
+        });
+    }
+
+    void CommandBuffer::clear()
+    {
+        mCommands.clear();
+        mNumEntities = 0;
+        mOnApplied = nullptr;
+    }
+
+    void CommandBuffer::record(size_t entity, bool deferred, std::function<void(Scene&, size_t)> apply)
+    {
+        mCommands.push_back(Command{APPLY, entity, deferred, std::move(apply)});
+    }
+
+    void CommandBuffer::apply(Scene& scene)
+    {
+        std::vector<size_t> created(mNumEntities, INVALID_ENTITY_ID);
+        for(auto & command : mCommands){
+            if(command.type == CREATE_ENTITY){
+                if(auto entity = scene.createEntity().lock())
+                    created[command.entity] = entity->getId();
+                continue;
+            }
+            auto id = command.deferred ? created[command.entity] : command.entity;
+            //the entity may have been destroyed between recording and now
+            if(!scene.isAlive(id)){
+                ofLogWarning("Scene") << "CommandBuffer: skipping a command for entity " << id << ", it isn't alive";
+                continue;
+            }
+            if(command.type == DESTROY_ENTITY){
+                scene.destroyEntity(id);
+            }else{
+                command.apply(scene, id);
+            }
+        }
+        if(mOnApplied)
+            mOnApplied(created);
+    }
+
+}//end namespace mediasystem
@@ -0,0 +1,127 @@
+//
+//  CommandBuffer.h
+//  ofxMediaSystem
+//
+
+#pragma once
+
+#include <tuple>
+#include <vector>
+#include <functional>
+#include <type_traits>
+#include "mediasystem/core/ComponentStorage.h"
+#include "mediasystem/util/TupleHelpers.hpp"
+
+namespace mediasystem {
+
+    class Scene;
+    class Entity;
+
+    //An entity a CommandBuffer will create, it only means something to the buffer that made it.
+    struct DeferredEntity {
+        size_t index;
+    };
+
+    //Structural changes recorded off the main thread and applied later by the scene in one go, see
+    //Scene::submit. A buffer is a plain container, record into one per thread and hand it over when
+    //it's done, nothing is locked until then. Commands run in the order they were recorded, against
+    //either a live entity id or an entity created earlier in the same buffer. Component arguments are
+    //copied into the buffer and moved into the component when it's created.
+    class CommandBuffer {
+    public:
+
+        CommandBuffer() = default;
+
+        //non copyable
+        CommandBuffer(const CommandBuffer&) = delete;
+        CommandBuffer& operator=(const CommandBuffer&) = delete;
+
+        CommandBuffer(CommandBuffer&&) = default;
+        CommandBuffer& operator=(CommandBuffer&&) = default;
+
+        DeferredEntity createEntity();
+        void destroyEntity(size_t entity_id);
+        void destroyEntity(DeferredEntity entity);
+
+        template<typename ComponentType, typename...Args>
+        void createComponent(size_t entity_id, Args&&...args){
+            record(entity_id, false, CreateComponent<ComponentType, typename std::decay<Args>::type...>(std::tuple<typename std::decay<Args>::type...>(std::forward<Args>(args)...)));
+        }
+
+        template<typename ComponentType, typename...Args>
+        void createComponent(DeferredEntity entity, Args&&...args){
+            record(entity.index, true, CreateComponent<ComponentType, typename std::decay<Args>::type...>(std::tuple<typename std::decay<Args>::type...>(std::forward<Args>(args)...)));
+        }
+
+        template<typename ComponentType>
+        void destroyComponent(size_t entity_id){
+            record(entity_id, false, DestroyComponent(type_index<ComponentType>()));
+        }
+
+        template<typename ComponentType>
+        void destroyComponent(DeferredEntity entity){
+            record(entity.index, true, DestroyComponent(type_index<ComponentType>()));
+        }
+
+        //runs fn on the main thread when the buffer is applied, ie. for components like Drawable
+        //that are constructed with their Entity
+        void run(size_t entity_id, std::function<void(Entity&)> fn);
+        void run(DeferredEntity entity, std::function<void(Entity&)> fn);
+
+        //called on the main thread once the buffer is applied, with the ids of the entities it
+        //created indexed by DeferredEntity::index, INVALID_ENTITY_ID where one couldn't be created
+        void onApplied(std::function<void(const std::vector<size_t>&)> fn){ mOnApplied = std::move(fn); }
+
+        inline size_t size() const { return mCommands.size(); }
+        inline bool empty() const { return mCommands.empty(); }
+        void clear();
+
+    private:
+
+        template<typename ComponentType, typename...Args>
+        struct CreateComponent {
+            CreateComponent(std::tuple<Args...> _args):args(std::move(_args)){}
+            //Scene is only complete where commands are recorded and applied
+            template<typename SceneType>
+            void operator()(SceneType& scene, size_t entity_id){
+                create(scene, entity_id, gen_seq<sizeof...(Args)>());
+            }
+            //the entity's signature is kept up to date like Entity::createComponent does, so destroying the entity removes it
+            template<typename SceneType, int...Is>
+            void create(SceneType& scene, size_t entity_id, seq<Is...>){
+                if(!scene.template createComponent<ComponentType>(entity_id, std::move(std::get<Is>(args))...).expired())
+                    scene.markComponent(entity_id, type_index<ComponentType>());
+            }
+            std::tuple<Args...> args;
+        };
+
+        struct DestroyComponent {
+            DestroyComponent(type_index_t _type):type(_type){}
+            template<typename SceneType>
+            void operator()(SceneType& scene, size_t entity_id){
+                if(scene.destroyComponent(type, entity_id))
+                    scene.unmarkComponent(entity_id, type);
+            }
+            type_index_t type;
+        };
+
+        enum CommandType { CREATE_ENTITY, DESTROY_ENTITY, APPLY };
+
+        struct Command {
+            CommandType type;
+            size_t entity; //an entity id, or an index into the created entities if deferred
+            bool deferred;
+            std::function<void(Scene&, size_t)> apply;
+        };
+
+        void record(size_t entity, bool deferred, std::function<void(Scene&, size_t)> apply);
+        //applied by Scene::applyCommands, on the main thread
+        void apply(Scene& scene);
+
+        std::vector<Command> mCommands;
+        size_t mNumEntities{0};
+        std::function<void(const std::vector<size_t>&)> mOnApplied;
+        friend Scene;
+    };
+
+}//end namespace mediasystem
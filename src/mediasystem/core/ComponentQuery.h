@@ -0,0 +1,197 @@
+//
+//  ComponentQuery.h
+//  ofxMediaSystem
+//
+
+#pragma once
+
+#include <tuple>
+#include <vector>
+#include "mediasystem/core/ComponentStorage.h"
+#include "mediasystem/core/ComponentSignature.h"
+#include "mediasystem/util/TupleHelpers.hpp"
+
+namespace mediasystem {
+
+    class Scene;
+
+    //Type erased part of a ComponentQuery. Keeps a packed list of the entities that have every included
+    //component and none of the excluded ones, maintained by observing the storages involved so it is
+    //never rebuilt.
+    class ComponentQueryBase : public IComponentObserver {
+    public:
+
+        virtual ~ComponentQueryBase(){
+            for(auto storage : mIncluded){
+                storage->removeObserver(this);
+            }
+            for(auto storage : mExcluded){
+                storage->removeObserver(this);
+            }
+        }
+
+        //non copyable
+        ComponentQueryBase(const ComponentQueryBase&) = delete;
+        ComponentQueryBase& operator=(const ComponentQueryBase&) = delete;
+
+        inline size_t size() const { return mEntities.size() - mHoles; }
+        inline bool empty() const { return size() == 0; }
+
+        inline bool contains(size_t entity_id) const {
+            auto index = getEntityIndex(entity_id);
+            return index < mPositions.size() && mPositions[index] != NO_POSITION && mEntities[mPositions[index]] == entity_id;
+        }
+
+        //unordered, holds INVALID_ENTITY_ID for entities that stopped matching during an each()
+        inline const std::vector<size_t>& getEntityIds() const { return mEntities; }
+
+    protected:
+
+        static constexpr size_t NO_POSITION = std::numeric_limits<size_t>::max();
+
+        ComponentQueryBase(type_id_t type, std::vector<IComponentStorage*> included, std::vector<IComponentStorage*> excluded):
+            mType(type),
+            mIncluded(std::move(included)),
+            mExcluded(std::move(excluded))
+        {
+            for(auto storage : mExcluded){
+                mExcludeSignature.set(storage->getTypeIndex());
+            }
+            //everything that matches already lives in the smallest included storage
+            auto driver = mIncluded[0];
+            for(auto storage : mIncluded){
+                storage->addObserver(this);
+                if(storage->size() < driver->size())
+                    driver = storage;
+            }
+            for(auto storage : mExcluded){
+                storage->addObserver(this);
+            }
+            for(size_t slot = 0; slot < driver->getNumSlots(); ++slot){
+                auto entity_id = driver->getEntityId(slot);
+                if(entity_id != INVALID_ENTITY_ID && matches(entity_id))
+                    add(entity_id);
+            }
+        }
+
+        void onComponentAdded(IComponentStorage& storage, size_t entity_id) override { refresh(entity_id); }
+        void onComponentRemoved(IComponentStorage& storage, size_t entity_id) override { refresh(entity_id); }
+
+        inline bool matches(size_t entity_id) const {
+            for(auto storage : mIncluded){
+                if(!storage->has(entity_id))
+                    return false;
+            }
+            for(auto storage : mExcluded){
+                if(storage->has(entity_id))
+                    return false;
+            }
+            return true;
+        }
+
+        void refresh(size_t entity_id){
+            bool match = matches(entity_id);
+            if(match != contains(entity_id)){
+                match ? add(entity_id) : remove(entity_id);
+            }
+        }
+
+        void add(size_t entity_id){
+            auto index = getEntityIndex(entity_id);
+            if(index >= mPositions.size()){
+                mPositions.resize(index + 1, NO_POSITION);
+            }
+            mPositions[index] = mEntities.size();
+            mEntities.push_back(entity_id);
+        }
+
+        void remove(size_t entity_id){
+            auto index = getEntityIndex(entity_id);
+            auto position = mPositions[index];
+            mPositions[index] = NO_POSITION;
+            if(mIterating){
+                //positions have to stay put while each() walks them, the hole is compacted afterwards
+                mEntities[position] = INVALID_ENTITY_ID;
+                ++mHoles;
+                return;
+            }
+            auto last = mEntities.back();
+            mEntities.pop_back();
+            if(position < mEntities.size()){
+                mEntities[position] = last;
+                mPositions[getEntityIndex(last)] = position;
+            }
+        }
+
+        inline void beginIteration(){ ++mIterating; }
+        void endIteration(){
+            if(--mIterating > 0 || mHoles == 0)
+                return;
+            size_t out = 0;
+            for(auto entity_id : mEntities){
+                if(entity_id == INVALID_ENTITY_ID)
+                    continue;
+                mPositions[getEntityIndex(entity_id)] = out;
+                mEntities[out++] = entity_id;
+            }
+            mEntities.resize(out);
+            mHoles = 0;
+        }
+
+        type_id_t mType;
+        ComponentSignature mExcludeSignature;
+        std::vector<IComponentStorage*> mIncluded;
+        std::vector<IComponentStorage*> mExcluded;
+        std::vector<size_t> mEntities;
+        std::vector<size_t> mPositions; //entity index -> position in mEntities
+        size_t mHoles{0};
+        size_t mIterating{0};
+        friend Scene;
+    };
+
+    //A persistent view, see Scene::query. Iterating costs O(matches), there is no filtering or
+    //allocation per frame. Matches are visited in no particular order. Components may be added and
+    //destroyed inside each(), entities that stop matching are skipped and ones that start matching
+    //are visited in the same pass.
+    template<typename...ComponentTypes>
+    class ComponentQuery : public ComponentQueryBase {
+    public:
+
+        static_assert(sizeof...(ComponentTypes) > 0, "A query needs at least one component type.");
+
+        using Storages = std::tuple<SparseComponentStorage<ComponentTypes>*...>;
+
+        //calls fn(size_t entity_id, ComponentTypes&...) for every match
+        template<typename Fn>
+        void each(Fn&& fn){
+            beginIteration();
+            for(size_t i = 0; i < mEntities.size(); ++i){
+                auto entity_id = mEntities[i];
+                if(entity_id != INVALID_ENTITY_ID)
+                    fn(entity_id, get<ComponentTypes>(entity_id)...);
+            }
+            endIteration();
+        }
+
+        //only valid for ids that are part of the query
+        template<typename ComponentType>
+        ComponentType& get(size_t entity_id){
+            return *get_element_by_type<SparseComponentStorage<ComponentType>*>(mStorages)->get(entity_id);
+        }
+
+    private:
+
+        ComponentQuery(Storages storages, std::vector<IComponentStorage*> excluded):
+            ComponentQueryBase(
+                type_id<ComponentQuery>,
+                {static_cast<IComponentStorage*>(get_element_by_type<SparseComponentStorage<ComponentTypes>*>(storages))...},
+                std::move(excluded)
+            ),
+            mStorages(std::move(storages))
+        {}
+
+        Storages mStorages;
+        friend Scene;
+    };
+
+}//end namespace mediasystem
@@ -0,0 +1,148 @@
+//
+//  ComponentSignature.h
+//  ofxMediaSystem
+//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include "mediasystem/util/TypeID.hpp"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace mediasystem {
+
+    namespace detail {
+
+        inline size_t count_trailing_zeros(uint64_t bits){
+#if defined(_MSC_VER)
+            unsigned long index;
+            _BitScanForward64(&index, bits);
+            return index;
+#else
+            return __builtin_ctzll(bits);
+#endif
+        }
+
+        inline size_t pop_count(uint64_t bits){
+#if defined(_MSC_VER)
+            return __popcnt64(bits);
+#else
+            return __builtin_popcountll(bits);
+#endif
+        }
+
+    }//end namespace detail
+
+    //Bitset of component type indices, the first 64 types are stored inline and it grows past that.
+    //forEach only visits set bits so teardown costs the number of components actually present.
+    class ComponentSignature {
+    public:
+
+        static constexpr size_t BITS_PER_WORD = 64;
+
+        inline bool test(type_index_t index) const {
+            auto word = index / BITS_PER_WORD;
+            return word < getNumWords() && (getWord(word) & bit(index));
+        }
+
+        inline void set(type_index_t index){
+            auto word = index / BITS_PER_WORD;
+            if(word > mOverflow.size()){
+                mOverflow.resize(word, 0);
+            }
+            getWord(word) |= bit(index);
+        }
+
+        inline void reset(type_index_t index){
+            auto word = index / BITS_PER_WORD;
+            if(word < getNumWords()){
+                getWord(word) &= ~bit(index);
+            }
+        }
+
+        inline void reset(){
+            mInline = 0;
+            mOverflow.clear();
+        }
+
+        inline bool none() const {
+            if(mInline)
+                return false;
+            for(auto word : mOverflow){
+                if(word)
+                    return false;
+            }
+            return true;
+        }
+
+        inline size_t count() const {
+            auto ret = detail::pop_count(mInline);
+            for(auto word : mOverflow){
+                ret += detail::pop_count(word);
+            }
+            return ret;
+        }
+
+        //calls fn(type_index_t) for every set bit in ascending order
+        template<typename Fn>
+        void forEach(Fn&& fn) const {
+            for(size_t word = 0; word < getNumWords(); ++word){
+                auto bits = getWord(word);
+                while(bits){
+                    auto offset = detail::count_trailing_zeros(bits);
+                    fn(word * BITS_PER_WORD + offset);
+                    bits &= bits - 1;
+                }
+            }
+        }
+
+        //true if every bit set in other is also set here
+        bool contains(const ComponentSignature& other) const {
+            for(size_t word = 0; word < other.getNumWords(); ++word){
+                auto bits = other.getWord(word);
+                if(bits && (word >= getNumWords() || (getWord(word) & bits) != bits))
+                    return false;
+            }
+            return true;
+        }
+
+        //true if any bit is set in both
+        bool intersects(const ComponentSignature& other) const {
+            auto words = std::min(getNumWords(), other.getNumWords());
+            for(size_t word = 0; word < words; ++word){
+                if(getWord(word) & other.getWord(word))
+                    return true;
+            }
+            return false;
+        }
+
+        bool operator==(const ComponentSignature& other) const {
+            auto words = std::max(getNumWords(), other.getNumWords());
+            for(size_t word = 0; word < words; ++word){
+                auto a = word < getNumWords() ? getWord(word) : 0;
+                auto b = word < other.getNumWords() ? other.getWord(word) : 0;
+                if(a != b)
+                    return false;
+            }
+            return true;
+        }
+        bool operator!=(const ComponentSignature& other) const { return !(*this == other); }
+
+    private:
+
+        static inline uint64_t bit(type_index_t index){ return uint64_t(1) << (index % BITS_PER_WORD); }
+
+        inline size_t getNumWords() const { return mOverflow.size() + 1; }
+        inline uint64_t getWord(size_t word) const { return word == 0 ? mInline : mOverflow[word - 1]; }
+        inline uint64_t& getWord(size_t word){ return word == 0 ? mInline : mOverflow[word - 1]; }
+
+        uint64_t mInline{0};
+        std::vector<uint64_t> mOverflow;
+    };
+
+}//end namespace mediasystem
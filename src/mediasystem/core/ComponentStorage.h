@@ -0,0 +1,738 @@
+//
+//  ComponentStorage.h
+//  ofxMediaSystem
+//
+
+#pragma once
+
+#include <vector>
+#include <limits>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <type_traits>
+#include <typeinfo>
+#include "mediasystem/core/Handle.h"
+#include "mediasystem/core/HandleConfig.h"
+#include "mediasystem/core/EntityId.h"
+#include "mediasystem/memory/Memory.h"
+#include "mediasystem/events/Delegate.h"
+#include "mediasystem/util/TypeID.hpp"
+
+namespace mediasystem {
+
+    constexpr size_t INVALID_COMPONENT_SLOT = std::numeric_limits<size_t>::max();
+    //change frame of a component that doesn't exist, components added in init() are stamped with frame 0
+    constexpr uint64_t NO_CHANGE_FRAME = std::numeric_limits<uint64_t>::max();
+
+    class IComponentStorage;
+
+    //memory held by a component storage, see IComponentStorage::getMemory
+    struct ComponentStorageMemory {
+        size_t objectSize{0};
+        size_t capacity{0}; //components that fit, live ones included, before the storage allocates again
+        size_t bytesReserved{0}; //object pages and index tables, including unused capacity
+        size_t bytesUsed{0}; //the live components and their index entries
+    };
+
+    //told when an entity gains or loses a storage's component, after the storage's own bookkeeping
+    //so has() already reflects the change. The component itself may not be constructed yet on add
+    //or already be destroyed on remove.
+    class IComponentObserver {
+    public:
+        virtual ~IComponentObserver() = default;
+        virtual void onComponentAdded(IComponentStorage& storage, size_t entity_id) = 0;
+        virtual void onComponentRemoved(IComponentStorage& storage, size_t entity_id) = 0;
+    };
+
+    enum class ComponentLifecycle { CONSTRUCT, DESTROY };
+
+    //see Scene::onConstruct and Scene::onDestroy
+    template<typename T>
+    using ComponentObserver = SA::delegate<void(size_t, T&)>;
+    using ComponentBatchObserver = SA::delegate<void(const std::vector<size_t>&)>;
+
+    //Delegates that may add or remove observers, themselves included, while being called.
+    //Removed ones are nulled and compacted once the outermost call returns, added ones
+    //are only called from the next call on.
+    template<typename Delegate>
+    class ObserverList {
+    public:
+
+        void add(const Delegate& observer){
+            mObservers.push_back(observer);
+        }
+
+        bool remove(const Delegate& observer){
+            auto found = std::find(mObservers.begin(), mObservers.end(), observer);
+            if(found == mObservers.end())
+                return false;
+            if(mCalling > 0){
+                *found = Delegate();
+                mHoles = true;
+            }else{
+                mObservers.erase(found);
+            }
+            return true;
+        }
+
+        template<typename...Args>
+        void call(Args&...args){
+            ++mCalling;
+            auto count = mObservers.size();
+            for(size_t i = 0; i < count; ++i){
+                auto observer = mObservers[i];
+                if(!observer.isNull())
+                    observer(args...);
+            }
+            if(--mCalling == 0 && mHoles){
+                mObservers.erase(std::remove_if(mObservers.begin(), mObservers.end(), [](const Delegate& observer){
+                    return observer.isNull();
+                }), mObservers.end());
+                mHoles = false;
+            }
+        }
+
+        //nulled observers count until compacted
+        inline size_t size() const { return mObservers.size(); }
+        inline bool empty() const { return mObservers.empty(); }
+
+    private:
+        std::vector<Delegate> mObservers;
+        size_t mCalling{0};
+        bool mHoles{false};
+    };
+
+    //type erased base of a component storage, owns the entity <-> slot bookkeeping
+    //so generic code (views, entity teardown) can work without knowing the component type.
+    //The sparse table is indexed by entity index, the slot stores the full id so stale ids are rejected.
+    //An external storage only indexes objects owned by someone else, see ArchetypeStorage.
+    //
+    //Every slot is stamped with the frame its component was added or last marked changed, read from
+    //the clock the owner passes in. Stamps are also appended to a change log so changed components
+    //can be listed without walking the whole storage.
+    class IComponentStorage {
+    public:
+
+        IComponentStorage(AllocationManager* manager, type_index_t type, const uint64_t* clock = nullptr):
+            mSparse(Allocator<size_t>(manager)),
+            mEntities(Allocator<size_t>(manager)),
+            mObjects(Allocator<void*>(manager)),
+            mFreeSlots(Allocator<size_t>(manager)),
+            mVersions(Allocator<uint64_t>(manager)),
+            mChangeLog(Allocator<ChangeRecord>(manager)),
+            mTypeIndex(type),
+            mClock(clock)
+        {}
+
+        virtual ~IComponentStorage() = default;
+
+        //non copyable
+        IComponentStorage(const IComponentStorage&) = delete;
+        IComponentStorage& operator=(const IComponentStorage&) = delete;
+
+        virtual type_id_t getType() const = 0;
+#if !defined(MS_GENERATIONAL_COMPONENT_HANDLES)
+        virtual Handle<void> getHandle(size_t entity_id) = 0;
+#endif
+        virtual bool remove(size_t entity_id) = 0;
+        //removes every listed entity's component in one pass, ids without one are skipped
+        virtual void removeBatch(const std::vector<size_t>& entity_ids) = 0;
+        virtual void clear() = 0;
+        //the objects of an external storage are not included, they belong to the ArchetypeStorage
+        virtual ComponentStorageMemory getMemory() const = 0;
+        //compiler specific, only meant for reports
+        virtual const char* getTypeName() const = 0;
+
+        inline type_index_t getTypeIndex() const { return mTypeIndex; }
+
+        //nullptr if the entity doesn't have the component
+        inline void* getComponentPtr(size_t entity_id) const {
+            auto slot = getSlot(entity_id);
+            return slot != INVALID_COMPONENT_SLOT ? mObjects[slot] : nullptr;
+        }
+
+        inline bool has(size_t entity_id) const {
+            return getSlot(entity_id) != INVALID_COMPONENT_SLOT;
+        }
+
+        inline size_t getSlot(size_t entity_id) const {
+            auto index = getEntityIndex(entity_id);
+            if(index < mSparse.size()){
+                auto slot = mSparse[index];
+                if(slot != INVALID_COMPONENT_SLOT && mEntities[slot] == entity_id)
+                    return slot;
+            }
+            return INVALID_COMPONENT_SLOT;
+        }
+
+        //entity id that owns a slot, INVALID_ENTITY_ID if the slot is not in use
+        inline size_t getEntityId(size_t slot) const { return mEntities[slot]; }
+        inline size_t getNumSlots() const { return mEntities.size(); }
+        inline size_t size() const { return mCount; }
+        inline bool empty() const { return mCount == 0; }
+
+        //used by the owner of external objects, which is responsible for constructing and destroying them
+        inline bool isExternal() const { return mExternal; }
+        inline void setExternal(){ mExternal = true; }
+        void linkExternal(size_t entity_id, void* object){
+            mObjects[linkSlot(entity_id)] = object;
+            notifyLifecycle(ComponentLifecycle::CONSTRUCT, entity_id, object);
+        }
+        void relocate(size_t entity_id, void* object){
+            mObjects[mSparse[getEntityIndex(entity_id)]] = object;
+        }
+        void unlinkExternal(size_t entity_id){
+            freeSlot(unlinkSlot(entity_id));
+        }
+
+        //stamps the entity's component with the current frame, false if it has none
+        bool markChanged(size_t entity_id){
+            auto slot = getSlot(entity_id);
+            if(slot == INVALID_COMPONENT_SLOT)
+                return false;
+            auto now = getFrame();
+            //logged once per frame, the slot can only change owner through linkSlot which logs too
+            if(mVersions[slot] != now){
+                mVersions[slot] = now;
+                logChange(now, entity_id);
+            }
+            return true;
+        }
+
+        //frame the component was added or last marked changed, NO_CHANGE_FRAME if the entity has none
+        inline uint64_t getVersion(size_t entity_id) const {
+            auto slot = getSlot(entity_id);
+            return slot != INVALID_COMPONENT_SLOT ? mVersions[slot] : NO_CHANGE_FRAME;
+        }
+
+        //Calls fn(entity_id) once for every component added or marked changed in frame `since` or later.
+        //Inclusive, so changes made in that frame after the caller last looked aren't missed.
+        //Requests older than the change log fall back to walking every slot.
+        template<typename Fn>
+        void forEachChanged(uint64_t since, Fn&& fn){
+            if(since >= mLogStart){
+                auto it = std::lower_bound(mChangeLog.begin(), mChangeLog.end(), since, [](const ChangeRecord& record, uint64_t frame){
+                    return record.frame < frame;
+                });
+                //fn may mark more changes and grow the log, those are left for the next call
+                auto begin = size_t(it - mChangeLog.begin());
+                auto end = mChangeLog.size();
+                for(auto i = begin; i < end; ++i){
+                    auto record = mChangeLog[i];
+                    //skip removed components and older entries of components changed again since
+                    auto slot = getSlot(record.entity_id);
+                    if(slot != INVALID_COMPONENT_SLOT && mVersions[slot] == record.frame)
+                        fn(record.entity_id);
+                }
+            }else{
+                auto count = mEntities.size();
+                for(size_t slot = 0; slot < count; ++slot){
+                    auto entity_id = mEntities[slot];
+                    if(entity_id != INVALID_ENTITY_ID && mVersions[slot] >= since)
+                        fn(entity_id);
+                }
+            }
+        }
+
+        void addObserver(IComponentObserver* observer){
+            mObservers.push_back(observer);
+        }
+        void removeObserver(IComponentObserver* observer){
+            mObservers.erase(std::remove(mObservers.begin(), mObservers.end(), observer), mObservers.end());
+        }
+
+        void addBatchObserver(ComponentLifecycle event, const ComponentBatchObserver& observer){
+            getBatch(event).observers.add(observer);
+            ++mNumLifecycleObservers;
+        }
+        bool removeBatchObserver(ComponentLifecycle event, const ComponentBatchObserver& observer){
+            if(!getBatch(event).observers.remove(observer))
+                return false;
+            --mNumLifecycleObservers;
+            return true;
+        }
+
+        //hands every id gathered since the last flush to the batch observers, constructed ids are
+        //only passed on while the entity still has the component
+        void flushBatches(){
+            for(auto event : {ComponentLifecycle::CONSTRUCT, ComponentLifecycle::DESTROY}){
+                auto& batch = getBatch(event);
+                if(batch.pending.empty())
+                    continue;
+                //observers may add or remove components, those land in the next flush
+                std::swap(batch.pending, batch.flushing);
+                if(event == ComponentLifecycle::CONSTRUCT){
+                    batch.flushing.erase(std::remove_if(batch.flushing.begin(), batch.flushing.end(), [this](size_t entity_id){
+                        return !has(entity_id);
+                    }), batch.flushing.end());
+                }
+                if(!batch.flushing.empty())
+                    batch.observers.call(batch.flushing);
+                batch.flushing.clear();
+            }
+        }
+
+    protected:
+
+        struct LifecycleBatch {
+            ObserverList<ComponentBatchObserver> observers;
+            std::vector<size_t> pending;
+            std::vector<size_t> flushing;
+        };
+
+        inline LifecycleBatch& getBatch(ComponentLifecycle event){
+            return mBatches[event == ComponentLifecycle::CONSTRUCT ? 0 : 1];
+        }
+
+        //calls the typed immediate observers
+        virtual void dispatchLifecycle(ComponentLifecycle event, size_t entity_id, void* object) = 0;
+
+        //construct after the object is in place, destroy while it is still intact
+        inline void notifyLifecycle(ComponentLifecycle event, size_t entity_id, void* object){
+            if(mNumLifecycleObservers == 0)
+                return;
+            auto& batch = getBatch(event);
+            if(!batch.observers.empty())
+                batch.pending.push_back(entity_id);
+            dispatchLifecycle(event, entity_id, object);
+        }
+
+        struct ChangeRecord {
+            uint64_t frame;
+            size_t entity_id;
+        };
+
+        inline uint64_t getFrame() const { return mClock ? *mClock : 0; }
+
+        //bytes of the slot and sparse tables, the change log is only counted as reserved
+        void addIndexMemory(ComponentStorageMemory& memory) const {
+            constexpr size_t slotBytes = sizeof(size_t) + sizeof(void*) + sizeof(uint64_t);
+            memory.bytesReserved += mSparse.capacity() * sizeof(size_t)
+                + mEntities.capacity() * sizeof(size_t)
+                + mObjects.capacity() * sizeof(void*)
+                + mVersions.capacity() * sizeof(uint64_t)
+                + mFreeSlots.capacity() * sizeof(size_t)
+                + mChangeLog.capacity() * sizeof(ChangeRecord)
+                + mObservers.capacity() * sizeof(IComponentObserver*);
+            memory.bytesUsed += mCount * (slotBytes + sizeof(size_t));
+        }
+
+        void logChange(uint64_t frame, size_t entity_id){
+            //keep the log within a couple of entries per component, dropping whole frames off the front
+            auto limit = std::max<size_t>(1024, mCount * 2);
+            if(mChangeLog.size() >= limit){
+                auto cut = mChangeLog.begin() + mChangeLog.size() / 2;
+                auto cutFrame = cut->frame;
+                cut = std::upper_bound(cut, mChangeLog.end(), cutFrame, [](uint64_t frame, const ChangeRecord& record){
+                    return frame < record.frame;
+                });
+                mChangeLog.erase(mChangeLog.begin(), cut);
+                mLogStart = cutFrame + 1;
+            }
+            mChangeLog.push_back(ChangeRecord{frame, entity_id});
+        }
+
+        //makes room for count more components without growing the slot tables
+        //returns the number of slots needed
+        size_t reserveSlots(size_t count){
+            auto slots = count > mFreeSlots.size() ? mEntities.size() + count - mFreeSlots.size() : mEntities.size();
+            mEntities.reserve(slots);
+            mObjects.reserve(slots);
+            mVersions.reserve(slots);
+            return slots;
+        }
+
+        size_t linkSlot(size_t entity_id){
+            size_t slot;
+            if(!mFreeSlots.empty()){
+                slot = mFreeSlots.back();
+                mFreeSlots.pop_back();
+            }else{
+                slot = mEntities.size();
+                mEntities.push_back(INVALID_ENTITY_ID);
+                mObjects.push_back(nullptr);
+                mVersions.push_back(0);
+            }
+            auto index = getEntityIndex(entity_id);
+            if(index >= mSparse.size()){
+                mSparse.resize(index + 1, INVALID_COMPONENT_SLOT);
+            }
+            mSparse[index] = slot;
+            mEntities[slot] = entity_id;
+            ++mCount;
+            //a new component counts as changed
+            auto now = getFrame();
+            mVersions[slot] = now;
+            logChange(now, entity_id);
+            for(auto observer : mObservers){
+                observer->onComponentAdded(*this, entity_id);
+            }
+            return slot;
+        }
+
+        size_t unlinkSlot(size_t entity_id){
+            auto index = getEntityIndex(entity_id);
+            auto slot = mSparse[index];
+            //every removal path unlinks before the object is destroyed
+            notifyLifecycle(ComponentLifecycle::DESTROY, entity_id, mObjects[slot]);
+            mSparse[index] = INVALID_COMPONENT_SLOT;
+            mEntities[slot] = INVALID_ENTITY_ID;
+            mObjects[slot] = nullptr;
+            --mCount;
+            for(auto observer : mObservers){
+                observer->onComponentRemoved(*this, entity_id);
+            }
+            return slot;
+        }
+
+        void freeSlot(size_t slot){
+            mFreeSlots.push_back(slot);
+        }
+
+        std::vector<size_t, Allocator<size_t>> mSparse; //entity index -> slot
+        std::vector<size_t, Allocator<size_t>> mEntities; //slot -> entity id
+        std::vector<void*, Allocator<void*>> mObjects; //slot -> component
+        std::vector<size_t, Allocator<size_t>> mFreeSlots;
+        std::vector<uint64_t, Allocator<uint64_t>> mVersions; //slot -> frame last added or changed
+        std::vector<ChangeRecord, Allocator<ChangeRecord>> mChangeLog; //ascending frames
+        std::vector<IComponentObserver*> mObservers;
+        LifecycleBatch mBatches[2];
+        size_t mNumLifecycleObservers{0}; //immediate and batch
+        uint64_t mLogStart{0}; //the log has every change from this frame on
+        size_t mCount{0};
+        type_index_t mTypeIndex;
+        const uint64_t* mClock;
+        bool mExternal{false};
+    };
+
+    //Sparse set of components of a single type.
+    //Components live by value in fixed size pages, so their address never changes for their lifetime.
+    //This matters because handles alias into the pages and because types like ofNode keep raw pointers
+    //to their parent and children. Freed slots are recycled so the pages stay densely packed.
+    //With shared handles a removed component lives on until outside locks are released, even past the
+    //storage, its page is kept until then. With generational handles it is destroyed right away and
+    //outstanding handles simply stop resolving.
+    //In an archetype scene relocatable types are owned by the ArchetypeStorage and this only indexes them.
+    template<typename T>
+    class SparseComponentStorage : public IComponentStorage {
+    public:
+
+        static constexpr size_t PAGE_BYTES = 16 * 1024;
+        static constexpr size_t OBJECTS_PER_PAGE = sizeof(T) >= PAGE_BYTES ? 1 : PAGE_BYTES / sizeof(T);
+
+        struct Page {
+            typename std::aligned_storage<sizeof(T), alignof(T)>::type objects[OBJECTS_PER_PAGE];
+        };
+
+        class iterator {
+        public:
+            iterator& operator++(){ mSlot = mStorage->nextSlot(mSlot + 1); return *this; }
+            T& operator*() const { return *mStorage->getObject(mSlot); }
+            T* operator->() const { return mStorage->getObject(mSlot); }
+            bool operator==(const iterator& other) const { return mSlot == other.mSlot; }
+            bool operator!=(const iterator& other) const { return mSlot != other.mSlot; }
+            size_t getEntityId() const { return mStorage->getEntityId(mSlot); }
+            iterator(SparseComponentStorage* storage = nullptr, size_t slot = 0):mStorage(storage),mSlot(slot){}
+        private:
+            SparseComponentStorage* mStorage;
+            size_t mSlot;
+        };
+
+        SparseComponentStorage(AllocationManager* manager, const uint64_t* clock = nullptr):
+            IComponentStorage(manager, type_index<T>(), clock),
+            mManager(manager),
+            mPages(Allocator<Page*>(manager))
+#if !defined(MS_GENERATIONAL_COMPONENT_HANDLES)
+            ,mHandles(Allocator<StrongHandle<T>>(manager))
+            ,mLifetime(std::make_shared<Lifetime>())
+#endif
+        {
+#if !defined(MS_GENERATIONAL_COMPONENT_HANDLES)
+            mLifetime->storage = this;
+#endif
+        }
+
+        ~SparseComponentStorage(){
+            clear();
+#if !defined(MS_GENERATIONAL_COMPONENT_HANDLES)
+            //slots that weren't freed are still locked outside, their pages are left to the last deleter
+            mLifetime->storage = nullptr;
+            mLifetime->locked.assign(mPages.size(), 0);
+            if(!mExternal){
+                for(size_t slot = 0; slot < mEntities.size(); ++slot){
+                    ++mLifetime->locked[slot / OBJECTS_PER_PAGE];
+                }
+                for(auto slot : mFreeSlots){
+                    --mLifetime->locked[slot / OBJECTS_PER_PAGE];
+                }
+            }
+            for(size_t page = 0; page < mPages.size(); ++page){
+                if(mLifetime->locked[page] == 0){
+                    deallocatePage(mPages[page]);
+                }
+            }
+            mLifetime->pages.assign(mPages.begin(), mPages.end());
+#else
+            for(auto & page : mPages){
+                deallocatePage(page);
+            }
+#endif
+        }
+
+        template<typename...Args>
+        ComponentStrongHandle<T> emplace(size_t entity_id, Args&&...args){
+            if(has(entity_id))
+                return nullptr;
+            auto slot = linkSlot(entity_id);
+            if(slot / OBJECTS_PER_PAGE >= mPages.size()){
+                mPages.push_back(allocatePage());
+            }
+            auto ptr = reinterpret_cast<T*>(&mPages[slot / OBJECTS_PER_PAGE]->objects[slot % OBJECTS_PER_PAGE]);
+            new(ptr) T(std::forward<Args>(args)...);
+            mObjects[slot] = ptr;
+#if defined(MS_GENERATIONAL_COMPONENT_HANDLES)
+            notifyLifecycle(ComponentLifecycle::CONSTRUCT, entity_id, ptr);
+            return ptr;
+#else
+            if(slot >= mHandles.size()){
+                mHandles.resize(slot + 1);
+            }
+            //the storage keeps one strong ref, the slot is only destroyed once outside locks are released
+            mHandles[slot] = StrongHandle<T>(ptr, SlotDeleter{mLifetime, slot}, Allocator<T>(mManager));
+            //copied, an observer may remove the component again
+            auto handle = mHandles[slot];
+            notifyLifecycle(ComponentLifecycle::CONSTRUCT, entity_id, ptr);
+            return handle;
+#endif
+        }
+
+        void addLifecycleObserver(ComponentLifecycle event, const ComponentObserver<T>& observer){
+            getObservers(event).add(observer);
+            ++mNumLifecycleObservers;
+        }
+        bool removeLifecycleObserver(ComponentLifecycle event, const ComponentObserver<T>& observer){
+            if(!getObservers(event).remove(observer))
+                return false;
+            --mNumLifecycleObservers;
+            return true;
+        }
+
+        //reserves slots and, unless the objects live elsewhere, the pages for count more components,
+        //new pages are written once so they're resident before the first component lands in them
+        void reserve(size_t count){
+            auto slots = reserveSlots(count);
+            if(mExternal)
+                return;
+            auto pages = (slots + OBJECTS_PER_PAGE - 1) / OBJECTS_PER_PAGE;
+            mPages.reserve(pages);
+            while(mPages.size() < pages){
+                mPages.push_back(allocatePage());
+                std::memset(mPages.back(), 0, sizeof(Page));
+            }
+#if !defined(MS_GENERATIONAL_COMPONENT_HANDLES)
+            mHandles.reserve(slots);
+#endif
+        }
+
+        inline T* get(size_t entity_id){
+            return static_cast<T*>(getComponentPtr(entity_id));
+        }
+
+        inline ComponentStrongHandle<T> getStrongHandle(size_t entity_id){
+#if defined(MS_GENERATIONAL_COMPONENT_HANDLES)
+            return get(entity_id);
+#else
+            auto slot = getSlot(entity_id);
+            return slot != INVALID_COMPONENT_SLOT ? mHandles[slot] : nullptr;
+#endif
+        }
+
+        inline ComponentHandle<T> getComponentHandle(size_t entity_id){
+#if defined(MS_GENERATIONAL_COMPONENT_HANDLES)
+            return has(entity_id) ? ComponentHandle<T>(this, entity_id) : ComponentHandle<T>();
+#else
+            return getStrongHandle(entity_id);
+#endif
+        }
+
+        type_id_t getType() const override { return type_id<T>; }
+        const char* getTypeName() const override { return typeid(T).name(); }
+
+        ComponentStorageMemory getMemory() const override {
+            ComponentStorageMemory memory;
+            memory.objectSize = sizeof(T);
+            addIndexMemory(memory);
+            if(mExternal){
+                memory.capacity = mEntities.capacity();
+                return memory;
+            }
+            memory.capacity = mPages.size() * OBJECTS_PER_PAGE;
+            memory.bytesReserved += mPages.size() * sizeof(Page) + mPages.capacity() * sizeof(Page*);
+            memory.bytesUsed += mCount * sizeof(T);
+#if !defined(MS_GENERATIONAL_COMPONENT_HANDLES)
+            memory.bytesReserved += mHandles.capacity() * sizeof(StrongHandle<T>);
+            memory.bytesUsed += mCount * sizeof(StrongHandle<T>);
+#endif
+            return memory;
+        }
+
+#if !defined(MS_GENERATIONAL_COMPONENT_HANDLES)
+        Handle<void> getHandle(size_t entity_id) override {
+            return staticCast<void>(getStrongHandle(entity_id));
+        }
+#endif
+
+        bool remove(size_t entity_id) override {
+            if(!has(entity_id))
+                return false;
+            if(mExternal){
+                //the object belongs to the archetype storage, Scene removes through it so this only drops the index
+                unlinkExternal(entity_id);
+                return true;
+            }
+#if defined(MS_GENERATIONAL_COMPONENT_HANDLES)
+            auto ptr = get(entity_id);
+            auto slot = unlinkSlot(entity_id);
+            ptr->~T();
+            freeSlot(slot);
+#else
+            auto slot = unlinkSlot(entity_id);
+            mHandles[slot].reset();
+#endif
+            return true;
+        }
+
+        void removeBatch(const std::vector<size_t>& entity_ids) override {
+            for(auto entity_id : entity_ids){
+                SparseComponentStorage::remove(entity_id);
+            }
+        }
+
+        void clear() override {
+            for(size_t slot = 0; slot < mEntities.size(); ++slot){
+                if(mEntities[slot] != INVALID_ENTITY_ID){
+                    remove(mEntities[slot]);
+                }
+            }
+        }
+
+        iterator begin(){ return iterator(this, nextSlot(0)); }
+        iterator end(){ return iterator(this, mEntities.size()); }
+
+        //slot of the next live component at or after slot
+        inline size_t nextSlot(size_t slot) const {
+            auto count = mEntities.size();
+            while(slot < count && mEntities[slot] == INVALID_ENTITY_ID){
+                ++slot;
+            }
+            return slot;
+        }
+
+        inline T* getObject(size_t slot){
+            return static_cast<T*>(mObjects[slot]);
+        }
+
+    protected:
+
+        void dispatchLifecycle(ComponentLifecycle event, size_t entity_id, void* object) override {
+            auto& observers = getObservers(event);
+            if(!observers.empty())
+                observers.call(entity_id, *static_cast<T*>(object));
+        }
+
+    private:
+
+        inline ObserverList<ComponentObserver<T>>& getObservers(ComponentLifecycle event){
+            return event == ComponentLifecycle::CONSTRUCT ? mOnConstruct : mOnDestroy;
+        }
+
+        //pages come straight from the heap rather than the scene's AllocationManager, so one can be
+        //released after the scene is gone
+        static Page* allocatePage(){ return static_cast<Page*>(::operator new(sizeof(Page))); }
+        static void deallocatePage(Page* page){ ::operator delete(page); }
+
+#if !defined(MS_GENERATIONAL_COMPONENT_HANDLES)
+        //Shared by the storage and its handles' deleters. Once the storage is gone a deleter only destroys
+        //its component, and the last one in a page the storage left behind frees the page.
+        struct Lifetime {
+            SparseComponentStorage* storage{nullptr};
+            std::vector<Page*> pages; //the storage's pages, only those with locked slots are still valid
+            std::vector<size_t> locked; //page -> slots still locked outside
+        };
+
+        struct SlotDeleter {
+            std::shared_ptr<Lifetime> lifetime;
+            size_t slot;
+            void operator()(T* ptr) const {
+                ptr->~T();
+                if(lifetime->storage){
+                    lifetime->storage->freeSlot(slot);
+                    return;
+                }
+                auto page = slot / OBJECTS_PER_PAGE;
+                if(--lifetime->locked[page] == 0){
+                    deallocatePage(lifetime->pages[page]);
+                }
+            }
+        };
+#endif
+
+        AllocationManager* mManager;
+        ObserverList<ComponentObserver<T>> mOnConstruct;
+        ObserverList<ComponentObserver<T>> mOnDestroy;
+        std::vector<Page*, Allocator<Page*>> mPages;
+#if !defined(MS_GENERATIONAL_COMPONENT_HANDLES)
+        std::vector<StrongHandle<T>, Allocator<StrongHandle<T>>> mHandles; //slot -> owning handle
+        std::shared_ptr<Lifetime> mLifetime;
+#endif
+    };
+
+    namespace detail {
+
+        template<typename T>
+        struct generational_handle_storage {
+            using type = SparseComponentStorage<T>;
+            static T* get(type* storage, size_t entity_id){ return storage->get(entity_id); }
+        };
+
+        template<>
+        struct generational_handle_storage<void> {
+            using type = IComponentStorage;
+            static void* get(type* storage, size_t entity_id){ return storage->getComponentPtr(entity_id); }
+        };
+
+    }//end namespace detail
+
+    //Component handle that is a storage and an entity id. Locking looks the id up in the storage,
+    //a stale generation or a removed component resolves to nullptr. Selected in HandleConfig.h.
+    //The storage must outlive the handle, storages live as long as their scene.
+    template<typename T>
+    class GenerationalHandle {
+    public:
+
+        using Storage = typename detail::generational_handle_storage<T>::type;
+
+        GenerationalHandle() = default;
+        GenerationalHandle(Storage* storage, size_t entity_id):mStorage(storage),mEntityId(entity_id){}
+
+        inline T* lock() const {
+            return mStorage ? detail::generational_handle_storage<T>::get(mStorage, mEntityId) : nullptr;
+        }
+
+        inline bool expired() const { return lock() == nullptr; }
+        inline void reset(){ mStorage = nullptr; mEntityId = INVALID_ENTITY_ID; }
+        inline size_t getEntityId() const { return mEntityId; }
+
+        //convertable to bool
+        operator bool() const { return !expired(); }
+
+        bool operator==(const GenerationalHandle& other) const { return mStorage == other.mStorage && mEntityId == other.mEntityId; }
+        bool operator!=(const GenerationalHandle& other) const { return !(*this == other); }
+
+    private:
+        Storage* mStorage{nullptr};
+        size_t mEntityId{INVALID_ENTITY_ID};
+    };
+
+}//end namespace mediasystem
@@ -0,0 +1,213 @@
+//
+//  ComponentView.h
+//  ofxMediaSystem
+//
+
+#pragma once
+
+#include <tuple>
+#include <array>
+#include <vector>
+#include "mediasystem/core/ComponentStorage.h"
+#include "mediasystem/core/ArchetypeStorage.h"
+#include "mediasystem/util/TupleHelpers.hpp"
+
+namespace mediasystem {
+
+    class Scene;
+
+    //tag used to pass exclusion filters to Scene::view, ie. scene.view<A,B>(Exclude<C>())
+    template<typename...ExcludedTypes>
+    struct Exclude {};
+
+    //Iterates every entity that has all of ComponentTypes and none of the excluded types.
+    //Iteration is driven by the smallest of the included storages and every other storage
+    //is probed by entity id, components are handed out by reference so no handles are locked.
+    //Components may be destroyed while iterating, a destroyed component is skipped.
+    //In an archetype scene each() walks the matching chunks instead, when every included type is
+    //relocatable. Entities that gain or lose components inside fn change archetype and may be visited twice.
+    template<typename...ComponentTypes>
+    class ComponentView {
+    public:
+
+        static_assert(sizeof...(ComponentTypes) > 0, "A view needs at least one component type.");
+
+        using Storages = std::tuple<SparseComponentStorage<ComponentTypes>*...>;
+
+        //iterates entity ids
+        class iterator {
+        public:
+            iterator& operator++(){ mSlot = mView->nextSlot(mSlot + 1); return *this; }
+            size_t operator*() const { return mView->mDriver->getEntityId(mSlot); }
+            bool operator==(const iterator& other) const { return mSlot == other.mSlot; }
+            bool operator!=(const iterator& other) const { return mSlot != other.mSlot; }
+        private:
+            iterator(ComponentView* view, size_t slot):mView(view),mSlot(slot){}
+            ComponentView* mView;
+            size_t mSlot;
+            friend ComponentView;
+        };
+
+        iterator begin(){ return iterator(this, nextSlot(0)); }
+        iterator end(){ return iterator(this, mDriver->getNumSlots()); }
+
+        //calls fn(size_t entity_id, ComponentTypes&...) for every match
+        template<typename Fn>
+        void each(Fn&& fn){
+            if(mArchetypes){
+                eachInChunks(fn);
+                return;
+            }
+            for(size_t slot = nextSlot(0); slot < mDriver->getNumSlots(); slot = nextSlot(slot + 1)){
+                auto entity_id = mDriver->getEntityId(slot);
+                fn(entity_id, get<ComponentTypes>(entity_id)...);
+            }
+        }
+
+        //calls fn(size_t count, const size_t* entity_ids, ComponentTypes*...) with parallel arrays,
+        //a whole chunk at a time in an archetype scene and one entity at a time otherwise.
+        //Don't create or destroy components inside fn.
+        template<typename Fn>
+        void eachChunk(Fn&& fn){
+            if(!mArchetypes || !mPinnedExcluded.empty()){
+                each([&fn](size_t entity_id, ComponentTypes&...components){
+                    fn(size_t(1), &entity_id, &components...);
+                });
+                return;
+            }
+            for(size_t index = 0; index < mArchetypes->getNumArchetypes(); ++index){
+                auto& archetype = mArchetypes->getArchetype(index);
+                if(!matches(archetype))
+                    continue;
+                Columns columns{Column<ComponentTypes>(archetype)...};
+                for(auto & chunk : archetype.chunks){
+                    fn(chunk.count, archetype.getEntityIds(chunk), get_element_by_type<Column<ComponentTypes>>(columns).data(archetype, chunk)...);
+                }
+            }
+        }
+
+        //only valid for ids that are part of the view
+        template<typename ComponentType>
+        ComponentType& get(size_t entity_id){
+            return *get_element_by_type<SparseComponentStorage<ComponentType>*>(mStorages)->get(entity_id);
+        }
+
+        bool contains(size_t entity_id) const {
+            for(auto storage : mIncluded){
+                if(!storage->has(entity_id))
+                    return false;
+            }
+            for(auto storage : mExcluded){
+                if(storage->has(entity_id))
+                    return false;
+            }
+            return true;
+        }
+
+        //upper bound on the number of matches
+        size_t sizeHint() const { return mDriver->size(); }
+
+    private:
+
+        template<typename ComponentType>
+        struct Column {
+            Column(const ArchetypeStorage::Archetype& archetype):index(archetype.getColumn(type_index<ComponentType>())){}
+            inline ComponentType* data(const ArchetypeStorage::Archetype& archetype, const ArchetypeStorage::Chunk& chunk) const {
+                return static_cast<ComponentType*>(archetype.getColumnData(chunk, index));
+            }
+            size_t index;
+        };
+        using Columns = std::tuple<Column<ComponentTypes>...>;
+
+        ComponentView(Storages storages, std::vector<IComponentStorage*> excluded, ArchetypeStorage* archetypes):
+            mStorages(std::move(storages)),
+            mIncluded{{static_cast<IComponentStorage*>(get_element_by_type<SparseComponentStorage<ComponentTypes>*>(mStorages))...}},
+            mExcluded(std::move(excluded))
+        {
+            mDriver = mIncluded[0];
+            for(auto storage : mIncluded){
+                if(storage->size() < mDriver->size())
+                    mDriver = storage;
+            }
+            if(archetypes){
+                //pinned types aren't part of any archetype, including one means probing storages after all
+                bool chunked = true;
+                for(auto storage : mIncluded){
+                    chunked = chunked && storage->isExternal();
+                    mIncludeSignature.set(storage->getTypeIndex());
+                }
+                for(auto storage : mExcluded){
+                    if(storage->isExternal()){
+                        mExcludeSignature.set(storage->getTypeIndex());
+                    }else{
+                        mPinnedExcluded.push_back(storage);
+                    }
+                }
+                if(chunked)
+                    mArchetypes = archetypes;
+            }
+        }
+
+        inline bool matches(const ArchetypeStorage::Archetype& archetype) const {
+            return archetype.count > 0 && archetype.signature.contains(mIncludeSignature) && !archetype.signature.intersects(mExcludeSignature);
+        }
+
+        //walks rows back to front and re-reads the chunk every row, so the current entity
+        //may move out of its archetype (the row is refilled from the back) and chunks may be freed
+        template<typename Fn>
+        void eachInChunks(Fn& fn){
+            for(size_t index = 0; index < mArchetypes->getNumArchetypes(); ++index){
+                auto& archetype = mArchetypes->getArchetype(index);
+                if(!matches(archetype))
+                    continue;
+                Columns columns{Column<ComponentTypes>(archetype)...};
+                for(size_t chunk = archetype.chunks.size(); chunk-- > 0;){
+                    if(chunk >= archetype.chunks.size())
+                        continue;
+                    for(size_t row = archetype.chunks[chunk].count; row-- > 0;){
+                        if(chunk >= archetype.chunks.size())
+                            break;
+                        auto& current = archetype.chunks[chunk];
+                        if(row >= current.count)
+                            continue;
+                        auto entity_id = archetype.getEntityIds(current)[row];
+                        if(isPinnedExcluded(entity_id))
+                            continue;
+                        fn(entity_id, get_element_by_type<Column<ComponentTypes>>(columns).data(archetype, current)[row]...);
+                    }
+                }
+            }
+        }
+
+        inline bool isPinnedExcluded(size_t entity_id) const {
+            for(auto storage : mPinnedExcluded){
+                if(storage->has(entity_id))
+                    return true;
+            }
+            return false;
+        }
+
+        //first slot at or after slot in the driving storage whose entity matches
+        size_t nextSlot(size_t slot) const {
+            auto count = mDriver->getNumSlots();
+            for(; slot < count; ++slot){
+                auto entity_id = mDriver->getEntityId(slot);
+                if(entity_id != INVALID_ENTITY_ID && contains(entity_id))
+                    return slot;
+            }
+            return count;
+        }
+
+        Storages mStorages;
+        std::array<IComponentStorage*, sizeof...(ComponentTypes)> mIncluded;
+        std::vector<IComponentStorage*> mExcluded;
+        IComponentStorage* mDriver{nullptr};
+        //only set in archetype scenes when every included type lives in chunks
+        ArchetypeStorage* mArchetypes{nullptr};
+        ComponentSignature mIncludeSignature;
+        ComponentSignature mExcludeSignature;
+        std::vector<IComponentStorage*> mPinnedExcluded;
+        friend Scene;
+    };
+
+}//end namespace mediasystem
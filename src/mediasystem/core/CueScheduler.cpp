@@ -0,0 +1,189 @@
+//
+//  CueScheduler.cpp
+//  ofxMediaSystem
+//
+
+#include "CueScheduler.h"
+
+namespace mediasystem {
+
+    CueId CueScheduler::add(float executionTime, float interval, bool repeats, std::function<void()> handler)
+    {
+        size_t slot;
+        if(!mFreeSlots.empty()){
+            slot = mFreeSlots.back();
+            mFreeSlots.pop_back();
+        }else{
+            slot = mCues.size();
+            mCues.emplace_back();
+        }
+        auto& cue = mCues[slot];
+        cue.handler = std::move(handler);
+        cue.executionTime = executionTime;
+        cue.interval = interval;
+        cue.repeats = repeats;
+        cue.order = mOrder++;
+        if(mUpdating){
+            stage(slot);
+        }else{
+            push(slot);
+        }
+        return makeId(slot);
+    }
+
+    size_t CueScheduler::findSlot(CueId id) const
+    {
+        auto slot = id & INDEX_MASK;
+        if(slot < mCues.size() && mCues[slot].position != NO_POSITION && makeId(slot) == id)
+            return slot;
+        return NO_POSITION;
+    }
+
+    bool CueScheduler::has(CueId id) const
+    {
+        return findSlot(id) != NO_POSITION;
+    }
+
+    bool CueScheduler::cancel(CueId id)
+    {
+        auto slot = findSlot(id);
+        if(slot == NO_POSITION)
+            return false;
+        if(mCues[slot].staged){
+            unstage(slot);
+        }else{
+            erase(mCues[slot].position);
+        }
+        release(slot);
+        return true;
+    }
+
+    void CueScheduler::update(float time)
+    {
+        mUpdating = true;
+        while(!mHeap.empty() && mCues[mHeap.front()].executionTime <= time){
+            auto slot = mHeap.front();
+            auto& cue = mCues[slot];
+            auto id = makeId(slot);
+            auto repeats = cue.repeats;
+            //the handler may cancel its own cue or clear the scheduler, so it is run from here
+            auto handler = std::move(cue.handler);
+            erase(0);
+            if(repeats){
+                cue.executionTime += cue.interval;
+                stage(slot);
+            }else{
+                release(slot);
+            }
+            if(handler)
+                handler();
+            if(repeats && findSlot(id) != NO_POSITION)
+                mCues[slot].handler = std::move(handler);
+        }
+        mUpdating = false;
+        for(auto slot : mStaged){
+            mCues[slot].staged = false;
+            push(slot);
+        }
+        mStaged.clear();
+    }
+
+    void CueScheduler::clear()
+    {
+        //slots are kept so the generations carry on and old ids stay invalid
+        for(size_t slot = 0; slot < mCues.size(); ++slot){
+            if(mCues[slot].position != NO_POSITION)
+                release(slot);
+        }
+        mHeap.clear();
+        mStaged.clear();
+    }
+
+    void CueScheduler::push(size_t slot)
+    {
+        mCues[slot].position = mHeap.size();
+        mHeap.push_back(slot);
+        siftUp(mHeap.size() - 1);
+    }
+
+    void CueScheduler::erase(size_t position)
+    {
+        auto last = mHeap.back();
+        mHeap.pop_back();
+        if(position == mHeap.size())
+            return;
+        mHeap[position] = last;
+        mCues[last].position = position;
+        //the moved cue can belong either above or below the hole
+        if(position > 0 && earlier(last, mHeap[(position - 1) / 2])){
+            siftUp(position);
+        }else{
+            siftDown(position);
+        }
+    }
+
+    void CueScheduler::siftUp(size_t position)
+    {
+        auto slot = mHeap[position];
+        while(position > 0){
+            auto parent = (position - 1) / 2;
+            if(!earlier(slot, mHeap[parent]))
+                break;
+            mHeap[position] = mHeap[parent];
+            mCues[mHeap[position]].position = position;
+            position = parent;
+        }
+        mHeap[position] = slot;
+        mCues[slot].position = position;
+    }
+
+    void CueScheduler::siftDown(size_t position)
+    {
+        auto slot = mHeap[position];
+        auto count = mHeap.size();
+        while(true){
+            auto child = position * 2 + 1;
+            if(child >= count)
+                break;
+            if(child + 1 < count && earlier(mHeap[child + 1], mHeap[child]))
+                ++child;
+            if(!earlier(mHeap[child], slot))
+                break;
+            mHeap[position] = mHeap[child];
+            mCues[mHeap[position]].position = position;
+            position = child;
+        }
+        mHeap[position] = slot;
+        mCues[slot].position = position;
+    }
+
+    void CueScheduler::stage(size_t slot)
+    {
+        mCues[slot].staged = true;
+        mCues[slot].position = mStaged.size();
+        mStaged.push_back(slot);
+    }
+
+    void CueScheduler::unstage(size_t slot)
+    {
+        auto position = mCues[slot].position;
+        auto last = mStaged.back();
+        mStaged.pop_back();
+        if(position < mStaged.size()){
+            mStaged[position] = last;
+            mCues[last].position = position;
+        }
+        mCues[slot].staged = false;
+    }
+
+    void CueScheduler::release(size_t slot)
+    {
+        auto& cue = mCues[slot];
+        cue.handler = nullptr;
+        cue.staged = false;
+        cue.position = NO_POSITION;
+        ++cue.generation;
+        mFreeSlots.push_back(slot);
+    }
+
+}//end namespace mediasystem
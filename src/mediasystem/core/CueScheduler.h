@@ -0,0 +1,89 @@
+//
+//  CueScheduler.h
+//  ofxMediaSystem
+//
+
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <limits>
+#include <cstdint>
+#include <functional>
+
+namespace mediasystem {
+
+    //Cue ids are a slot index in the low half and a generation in the high half, like entity ids,
+    //so a cancelled or finished cue's id never matches the cue that reuses its slot.
+    using CueId = size_t;
+    constexpr CueId INVALID_CUE_ID = std::numeric_limits<size_t>::max();
+
+    //Timed callbacks of a scene, kept in a min-heap on execution time with an index from id to heap
+    //position. Adding and cancelling are O(log n) and an update only touches the cues that are due.
+    //Cues due at the same time run in the order they were added. A cue runs at most once per update,
+    //cues added or rescheduled while cues are running wait for the next update.
+    class CueScheduler {
+    public:
+
+        CueScheduler() = default;
+
+        //non copyable
+        CueScheduler(const CueScheduler&) = delete;
+        CueScheduler& operator=(const CueScheduler&) = delete;
+
+        //interval is added to the execution time every time a repeating cue runs
+        CueId add(float executionTime, float interval, bool repeats, std::function<void()> handler);
+        //false if the cue already ran or was cancelled, a cue may cancel itself from its handler
+        bool cancel(CueId id);
+        bool has(CueId id) const;
+        //runs every cue due at time, earliest first
+        void update(float time);
+        void clear();
+
+        inline size_t size() const { return mCues.size() - mFreeSlots.size(); }
+        inline bool empty() const { return size() == 0; }
+
+    private:
+
+        static constexpr size_t INDEX_BITS = sizeof(CueId) * 4;
+        static constexpr size_t INDEX_MASK = (size_t(1) << INDEX_BITS) - 1;
+        static constexpr size_t NO_POSITION = std::numeric_limits<size_t>::max();
+
+        struct Cue {
+            std::function<void()> handler;
+            float executionTime{0.f};
+            float interval{0.f};
+            bool repeats{false};
+            bool staged{false}; //waiting in mStaged instead of the heap
+            uint64_t order{0}; //breaks ties between equal execution times
+            size_t generation{0};
+            size_t position{NO_POSITION}; //index in mHeap or mStaged, NO_POSITION if the slot is free
+        };
+
+        inline CueId makeId(size_t slot) const { return (mCues[slot].generation << INDEX_BITS) | slot; }
+        //NO_POSITION unless id refers to a pending cue
+        size_t findSlot(CueId id) const;
+
+        inline bool earlier(size_t a, size_t b) const {
+            auto& first = mCues[a];
+            auto& second = mCues[b];
+            return first.executionTime < second.executionTime || (first.executionTime == second.executionTime && first.order < second.order);
+        }
+
+        void push(size_t slot);
+        void erase(size_t position);
+        void siftUp(size_t position);
+        void siftDown(size_t position);
+        void stage(size_t slot);
+        void unstage(size_t slot);
+        void release(size_t slot);
+
+        std::vector<Cue> mCues; //slot -> cue
+        std::vector<size_t> mFreeSlots;
+        std::vector<size_t> mHeap; //slots, earliest at the front
+        std::vector<size_t> mStaged; //slots added while cues were running
+        uint64_t mOrder{0};
+        bool mUpdating{false};
+    };
+
+}//end namespace mediasystem
@@ -7,52 +7,44 @@
 
 #include "Entity.h"
 #include "ofMain.h"
+#include "mediasystem/core/TransformSystem.h"
 
 namespace mediasystem {
     
-    EntityGraph::EntityGraph(Entity& me):self(me),children(me.getScene().getAllocator<EntityHandle>()){}
-    EntityGraph::~EntityGraph()
+    EntityGraph::EntityGraph(Entity& me):self(me){}
+    
+    SparseComponentStorage<EntityGraph>& EntityGraph::getGraphs(Scene& scene)
     {
-        children.clear();
-        parent.reset();
+        return scene.getStorage<EntityGraph>();
     }
     
     void EntityGraph::setParent(EntityHandle p, bool keepGlobalPosition){
-        if(auto p = parent.lock()){
-            clearParent(keepGlobalPosition);
+        auto& graphs = getGraphs(self.mScene);
+        auto ent = p.lock();
+        auto newParent = ent ? find(graphs, ent->getId()) : nullptr;
+        for(auto ancestor = newParent; ancestor; ancestor = find(graphs, ancestor->parent)){
+            if(ancestor == this){
+                MS_LOG_ERROR("EntityGraph: can't parent an entity to itself or one of its descendants.");
+                return;
+            }
         }
-        if(auto ent = p.lock()){
-            parent = std::move(p);
-            auto node = ent->getComponent<ofNode>();
-            auto myNode = self.getComponent<ofNode>();
-            myNode->setParent(*node, keepGlobalPosition);
-            auto graph = ent->getComponent<EntityGraph>();
-            graph->children.push_back(self.getScene().getEntity(self.getId()));
+        if(auto transforms = self.getScene().getTransformSystem())
+            transforms->markHierarchyDirty();
+        self.markTransformDirty();
+        unlink(keepGlobalPosition);
+        if(newParent){
+            link(*newParent, keepGlobalPosition);
         }
     }
     
     void EntityGraph::clearParent(bool keepTransform)
     {
-        if(auto p = parent.lock()){
-            auto graph = p->getComponent<EntityGraph>();
-            //remove self as child
-            auto it = graph->children.begin();
-            auto end = graph->children.end();
-            while(it != end){
-                if(auto ch = (*it).lock()){
-                    if(ch.get() == &self){
-                        auto node = ch->getComponent<ofNode>();
-                        node->clearParent(keepTransform);
-                        graph->children.erase(it);
-                        parent.reset();
-                        return;
-                    }
-                    ++it;
-                }else{
-                    it = graph->children.erase(it);
-                }
-            }
-        }
+        if(!hasParent())
+            return;
+        if(auto transforms = self.getScene().getTransformSystem())
+            transforms->markHierarchyDirty();
+        self.markTransformDirty();
+        unlink(keepTransform);
     }
     
     void EntityGraph::addChild(EntityHandle child, bool keepGlobalPosition){
@@ -64,178 +56,76 @@ namespace mediasystem {
     
     void EntityGraph::removeChild(EntityHandle child, bool keepGlobalPosition){
         if(auto ent = child.lock()){
-            auto it = children.begin();
-            auto end = children.end();
-            while(it != end){
-                if(auto ch = (*it).lock()){
-                    if(ch.get() == ent.get()){
-                        ch->clearParent(keepGlobalPosition);
-                        return;
-                    }
-                    ++it;
-                }else{
-                    it = children.erase(it);
-                }
+            auto graph = find(getGraphs(self.mScene), ent->getId());
+            if(graph && graph->parent == self.getId()){
+                graph->clearParent(keepGlobalPosition);
             }
         }
     }
     
-//    GraphComponent::GraphComponent(EntityHandle self):mSelf(self)
-//    {}
-//    
-//    GraphComponent::~GraphComponent()
-//    {
-//        
-//    }
-//    
-//    EntityHandle GraphComponent::findSiblingHead()
-//    {
-//        if(mPrevSibling.expired()){
-//            return mSelf;
-//        }else{
-//            auto iter = mPrevSibling.lock()->getComponent<GraphComponent>();
-//            EntityHandle ret = mPrevSibling;
-//            while(!iter->mPrevSibling.expired()){
-//                iter = iter->mPrevSibling.lock()->getComponent<GraphComponent>();
-//                ret = iter->mPrevSibling;
-//            }
-//            return ret;
-//        }
-//    }
-//    
-//    EntityHandle GraphComponent::findSiblingTail()
-//    {
-//        if(mNextSibling.expired()){
-//            return mSelf;
-//        }else{
-//            auto iter = mNextSibling.lock()->getComponent<GraphComponent>();
-//            EntityHandle ret = mNextSibling;
-//            while(!iter->mNextSibling.expired()){
-//                iter = iter->mNextSibling.lock()->getComponent<GraphComponent>();
-//                ret = iter->mNextSibling;
-//            }
-//            return ret;
-//        }
-//    }
-//    
-//    void GraphComponent::removeFromSiblings()
-//    {
-//        EntityHandle prev;
-//        EntityHandle next;
-//        StrongHandle<GraphComponent> prevGraph;
-//        StrongHandle<GraphComponent> nextGraph;
-//        if(!mPrevSibling.expired()){
-//            prevGraph = mPrevSibling.lock()->getComponent<GraphComponent>();
-//            prev = prevGraph->mNextSibling;
-//            mPrevSibling.reset();
-//        }
-//        if(!mNextSibling.expired()){
-//            nextGraph = mNextSibling.lock()->getComponent<GraphComponent>();
-//            next = nextGraph->mPrevSibling;
-//            mNextSibling.reset();
-//        }
-//        if(nextGraph){
-//            nextGraph->mPrevSibling = prev;
-//        }
-//        if(prevGraph){
-//            prevGraph->mNextSibling = next;
-//        }
-//    }
-//    
-//    void GraphComponent::setParent(EntityHandle p, bool keepGlobalPosition)
-//    {
-//        if(auto parent = mParent.lock()){
-//            removeFromParent(keepGlobalPosition);
-//        }
-//        mParent = std::move(p);
-//        if(auto parent = mParent.lock()){
-//            parent->getComponent<GraphComponent>()->addChild(mSelf, keepGlobalPosition);
-//        }
-//    }
-//    
-//    void GraphComponent::removeFromParent(bool keepGlobalPosition)
-//    {
-//        if(auto p = mParent.lock()){
-//            auto graph = p->getComponent<GraphComponent>();
-//            graph->removeChild(mSelf,keepGlobalPosition);
-//        }
-//    }
-//    
-//    void GraphComponent::addChild(EntityHandle child, bool keepGlobalPosition)
-//    {
-//        if(auto c = child.lock()){
-//            auto found = firstChild([c](const Entity& e){
-//                return c.get() == &e;
-//            });
-//            if(!found.expired()){
-//                ofLogWarning("GraphComponent") << "Graph already contain this child";
-//                return;
-//            }
-//            
-//            auto childGraph = c->getComponent<GraphComponent>();
-//            childGraph->setParent(mSelf,keepGlobalPosition);
-//            if(mChildHead.expired()){
-//                mChildHead = child;
-//            }else{
-//                auto headGraph = mChildHead.lock()->getComponent<GraphComponent>();
-//                auto tail = headGraph->findSiblingTail();
-//                tail.lock()->getComponent<GraphComponent>()->mNextSibling = child;
-//                childGraph->mPrevSibling = tail;
-//            }
-//        }
-//    }
-//    
-//    void GraphComponent::removeChild(EntityHandle child, bool keepGlobalPosition )
-//    {
-//        if(mChildHead.expired()){
-//            ofLogWarning("GraphComponent") << "Graph has no children to begin with!";
-//        }else{
-//            if(child.expired()){
-//                ofLogWarning("GraphComponent") << "handle is expired!";
-//                return;
-//            }
-//            auto c = child.lock();
-//            auto found = firstChild([c](const Entity& e){
-//                return c.get() == &e;
-//            });
-//            if(found.expired()){
-//                ofLogWarning("GraphComponent") << "Graph does not contain this child";
-//                return;
-//            }
-//            auto childGraph = c->getComponent<GraphComponent>();
-//            childGraph->removeFromParent();
-//            childGraph->removeFromSiblings();
-//        }
-//    }
-//    
-//    std::vector<EntityHandle> GraphComponent::getChildren()
-//    {
-//        std::vector<EntityHandle> ret;
-//        if(mChildHead.expired()){
-//            return ret;
-//        }else{
-//            auto iter = mNextSibling.lock()->getComponent<GraphComponent>();
-//            ret.push_back(mChildHead);
-//            while(!iter->mNextSibling.expired()){
-//                iter = iter->mNextSibling.lock()->getComponent<GraphComponent>();
-//                ret.push_back(mNextSibling);
-//            }
-//        }
-//        return ret;
-//    }
-//    
-//    std::vector<EntityHandle> GraphComponent::filterChildren( const std::function<bool(Entity&)>& predicate )
-//    {
-//        
-//    }
-//    
-//    EntityHandle GraphComponent::firstChild( const std::function<bool(Entity&)>& predicate )
-//    {
-//        
-//    }
-    
-    std::map<mediasystem::type_id_t, size_t> mediasystem::Entity::sComponentIds = {};
-    size_t mediasystem::Entity::sNextComponentId = 0;
+    EntityHandle EntityGraph::getParent() const
+    {
+        return hasParent() ? self.getScene().getEntity(parent) : EntityHandle();
+    }
+    
+    EntityGraph::Range<EntityGraph::ChildIterator> EntityGraph::getChildren() const
+    {
+        auto graphs = &getGraphs(self.mScene);
+        return Range<ChildIterator>(ChildIterator(graphs, find(*graphs, firstChild)), ChildIterator(graphs, nullptr));
+    }
+    
+    EntityGraph::Range<EntityGraph::SubtreeIterator> EntityGraph::getSubtree() const
+    {
+        auto graphs = &getGraphs(self.mScene);
+        auto root = const_cast<EntityGraph*>(this);
+        return Range<SubtreeIterator>(SubtreeIterator(graphs, root), SubtreeIterator(graphs, nullptr));
+    }
+    
+    //appends this as the last child of newParent, this must not have a parent
+    void EntityGraph::link(EntityGraph& newParent, bool keepGlobalPosition)
+    {
+        auto id = self.getId();
+        parent = newParent.self.getId();
+        prevSibling = newParent.lastChild;
+        if(auto tail = find(getGraphs(self.mScene), newParent.lastChild)){
+            tail->nextSibling = id;
+        }else{
+            newParent.firstChild = id;
+        }
+        newParent.lastChild = id;
+        ++newParent.numChildren;
+        auto& nodes = self.mScene.getStorage<ofNode>();
+        auto node = nodes.get(id);
+        auto parentNode = nodes.get(parent);
+        if(node && parentNode)
+            node->setParent(*parentNode, keepGlobalPosition);
+    }
+    
+    //detaches this from its parent and siblings, its own children stay
+    void EntityGraph::unlink(bool keepGlobalPosition)
+    {
+        if(!hasParent())
+            return;
+        auto& graphs = getGraphs(self.mScene);
+        auto oldParent = find(graphs, parent);
+        if(auto prev = find(graphs, prevSibling)){
+            prev->nextSibling = nextSibling;
+        }else if(oldParent){
+            oldParent->firstChild = nextSibling;
+        }
+        if(auto next = find(graphs, nextSibling)){
+            next->prevSibling = prevSibling;
+        }else if(oldParent){
+            oldParent->lastChild = prevSibling;
+        }
+        if(oldParent)
+            --oldParent->numChildren;
+        parent = INVALID_ENTITY_ID;
+        prevSibling = INVALID_ENTITY_ID;
+        nextSibling = INVALID_ENTITY_ID;
+        if(auto node = self.mScene.getStorage<ofNode>().get(self.getId()))
+            node->clearParent(keepGlobalPosition);
+    }
     
     Entity::Entity(Scene& scene, uint64_t id):
         mId(id),
@@ -246,31 +136,24 @@ namespace mediasystem {
     
     void Entity::clearComponents()
     {
-        if(hasComponent<EntityGraph>()){
-            auto graph = getComponent<EntityGraph>();
-            if(auto p = graph->parent.lock()){
-                auto myNode = getComponent<ofNode>();
-                if(myNode)
-                    myNode->clearParent(true);
-            }
-            for(auto& child : graph->children){
-                if(auto ent = child.lock()){
-                    auto node = ent->getComponent<ofNode>();
-                    if(node)
-                        node->clearParent(true);
-                }
-            }
-        }
-        for(size_t i = 0; i < mComponents.size(); i++){
-            if(mComponents[i]){
-                if(auto compType = getType(i)){
-                    mScene.destroyComponent(compType, mId);
-                }
-            }
-        }
+        detachNodes();
+        mScene.destroyComponents(mId, mComponents);
         mComponents.reset();
     }
     
+    void Entity::detachNodes()
+    {
+        auto& graphs = EntityGraph::getGraphs(mScene);
+        auto graph = EntityGraph::find(graphs, mId);
+        if(!graph)
+            return;
+        //the children become roots
+        graph->unlink(true);
+        while(auto child = EntityGraph::find(graphs, graph->firstChild)){
+            child->unlink(true);
+        }
+    }
+    
     bool Entity::destroy(){
         if(isValid()){
             mScene.destroyEntity(mId);
@@ -288,7 +171,7 @@ namespace mediasystem {
     EntityHandle Entity::getParent() const
     {
         auto graph = getComponent<EntityGraph>();
-        return graph->parent;
+        return graph->getParent();
     }
     
     void Entity::clearParent(bool bMaintainGlobalTransform)
@@ -309,31 +192,47 @@ namespace mediasystem {
         graph->removeChild(child);
     }
     
-    EntityHandleList& Entity::getChildren()
+    EntityGraph::Range<EntityGraph::ChildIterator> Entity::getChildren()
     {
         auto graph = getComponent<EntityGraph>();
-        return graph->children;
+        return graph->getChildren();
     }
     
     void Entity::removeChildren(bool keepGlobalPosition)
     {
-        auto graph = getComponent<EntityGraph>();
-        for(auto& child:graph->children){
-            graph->removeChild(child,keepGlobalPosition);
+        auto& graphs = EntityGraph::getGraphs(mScene);
+        auto graph = EntityGraph::find(graphs, mId);
+        while(auto child = EntityGraph::find(graphs, graph->firstChild)){
+            child->clearParent(keepGlobalPosition);
         }
     }
     
-    //node component pass through
+    //node component pass through, global getters read the TransformSystem cache when there is one
+    void Entity::markTransformDirty()
+    {
+        //only this entity, the TransformSystem and the screen area systems carry it to the descendants
+        //once per frame rather than once per setter
+        mScene.markChanged<ofNode>(mId);
+    }
+    
+    TransformSystem* Entity::getCachedTransforms() const
+    {
+        auto transforms = mScene.getTransformSystem();
+        return transforms && transforms->isCached(mId) ? transforms : nullptr;
+    }
+    
     void Entity::setPosition(float px, float py, float pz)
     {
         auto node = getComponent<ofNode>();
         node->setPosition(px, py, pz);
+        markTransformDirty();
     }
     
     void Entity::setPosition(const glm::vec3& p)
     {
         auto node = getComponent<ofNode>();
         node->setPosition(p);
+        markTransformDirty();
     }
     
     glm::vec3 Entity::getPosition() const
@@ -346,16 +245,20 @@ namespace mediasystem {
     {
         auto node = getComponent<ofNode>();
         node->setGlobalPosition(px, py, pz);
+        markTransformDirty();
     }
     
     void Entity::setGlobalPosition(const glm::vec3& p)
     {
         auto node = getComponent<ofNode>();
         node->setGlobalPosition(p);
+        markTransformDirty();
     }
     
     glm::vec3 Entity::getGlobalPosition() const
     {
+        if(auto transforms = getCachedTransforms())
+            return transforms->getGlobalPosition(mId);
         auto node = getComponent<ofNode>();
         return node->getGlobalPosition();
     }
@@ -365,12 +268,14 @@ namespace mediasystem {
     {
         auto node = getComponent<ofNode>();
         node->setOrientation(q);
+        markTransformDirty();
     }
     
     void Entity::setOrientation(const glm::vec3& eulerAngles)
     {
         auto node = getComponent<ofNode>();
         node->setOrientation(eulerAngles);
+        markTransformDirty();
     }
     
     glm::vec3 Entity::getOrientationEulerRad() const
@@ -425,10 +330,13 @@ namespace mediasystem {
     {
         auto node = getComponent<ofNode>();
         node->setGlobalOrientation(q);
+        markTransformDirty();
     }
     
     glm::quat Entity::getGlobalOrientation() const
     {
+        if(auto transforms = getCachedTransforms())
+            return transforms->getGlobalOrientation(mId);
         auto node = getComponent<ofNode>();
         return node->getGlobalOrientation();
     }
@@ -437,18 +345,21 @@ namespace mediasystem {
     {
         auto node = getComponent<ofNode>();
         node->setScale(s);
+        markTransformDirty();
     }
     
     void Entity::setScale(float sx, float sy, float sz)
     {
         auto node = getComponent<ofNode>();
         node->setScale(sx, sy, sz);
+        markTransformDirty();
     }
     
     void Entity::setScale(const glm::vec3& s)
     {
         auto node = getComponent<ofNode>();
         node->setScale(s);
+        markTransformDirty();
     }
     
     glm::vec3 Entity::getScale() const
@@ -459,12 +370,16 @@ namespace mediasystem {
     
     glm::vec3 Entity::getGlobalScale() const
     {
+        if(auto transforms = getCachedTransforms())
+            return transforms->getGlobalScale(mId);
         auto node = getComponent<ofNode>();
         return node->getGlobalScale();
     }
     
     glm::mat4 Entity::getGlobalTransformMatrix() const
     {
+        if(auto transforms = getCachedTransforms())
+            return transforms->getGlobalTransformMatrix(mId);
         auto node = getComponent<ofNode>();
         return node->getGlobalTransformMatrix();
     }
@@ -6,10 +6,10 @@
 //
 
 #pragma once
-#include <bitset>
 #include <memory>
 #include <numeric>
 #include "mediasystem/util/TypeID.hpp"
+#include "mediasystem/core/ComponentSignature.h"
 #include "Scene.h"
 #include "Handle.h"
 
@@ -18,51 +18,104 @@ namespace mediasystem {
     class Entity;
     using EntityStrongHandle = StrongHandle<Entity>;
     using EntityHandle = Handle<Entity>;
-    using EntityHandleList = std::list<EntityHandle, Allocator<EntityHandle>>;
     
+    //Intrusive hierarchy. Every graph links its parent, first and last child and siblings by entity id,
+    //so reparenting and unlinking are O(1) and walking the tree doesn't allocate. Links never go stale,
+    //an entity is unlinked from its parent and children before its components are destroyed.
     struct EntityGraph {
-        EntityGraph(Entity& me);
-        ~EntityGraph();
+        
+        //follows nextSibling, yields the graphs of an entity's children
+        class ChildIterator {
+        public:
+            ChildIterator(SparseComponentStorage<EntityGraph>* graphs, EntityGraph* graph):mGraphs(graphs),mGraph(graph){}
+            inline ChildIterator& operator++(){ mGraph = find(*mGraphs, mGraph->nextSibling); return *this; }
+            inline EntityGraph& operator*() const { return *mGraph; }
+            inline EntityGraph* operator->() const { return mGraph; }
+            inline bool operator==(const ChildIterator& other) const { return mGraph == other.mGraph; }
+            inline bool operator!=(const ChildIterator& other) const { return mGraph != other.mGraph; }
+        private:
+            SparseComponentStorage<EntityGraph>* mGraphs;
+            EntityGraph* mGraph;
+        };
+        
+        //pre order walk of a subtree, parents come before their children, without a stack
+        class SubtreeIterator {
+        public:
+            SubtreeIterator(SparseComponentStorage<EntityGraph>* graphs, EntityGraph* root):mGraphs(graphs),mRoot(root),mGraph(root){}
+            SubtreeIterator& operator++(){
+                if(auto child = find(*mGraphs, mGraph->firstChild)){
+                    mGraph = child;
+                    return *this;
+                }
+                while(mGraph != mRoot){
+                    if(auto next = find(*mGraphs, mGraph->nextSibling)){
+                        mGraph = next;
+                        return *this;
+                    }
+                    mGraph = find(*mGraphs, mGraph->parent);
+                }
+                mGraph = nullptr;
+                return *this;
+            }
+            inline EntityGraph& operator*() const { return *mGraph; }
+            inline EntityGraph* operator->() const { return mGraph; }
+            inline bool operator==(const SubtreeIterator& other) const { return mGraph == other.mGraph; }
+            inline bool operator!=(const SubtreeIterator& other) const { return mGraph != other.mGraph; }
+        private:
+            SparseComponentStorage<EntityGraph>* mGraphs;
+            EntityGraph* mRoot;
+            EntityGraph* mGraph;
+        };
+        
+        template<typename Iterator>
+        class Range {
+        public:
+            Range(Iterator first, Iterator last):mBegin(first),mEnd(last){}
+            inline Iterator begin() const { return mBegin; }
+            inline Iterator end() const { return mEnd; }
+        private:
+            Iterator mBegin;
+            Iterator mEnd;
+        };
+        
+        explicit EntityGraph(Entity& me);
+        EntityGraph(EntityGraph&&) = default;
         
         Entity& self;
-        EntityHandle parent;
-        EntityHandleList children;
+        //entity ids, INVALID_ENTITY_ID when there is none
+        size_t parent{INVALID_ENTITY_ID};
+        size_t firstChild{INVALID_ENTITY_ID};
+        size_t lastChild{INVALID_ENTITY_ID};
+        size_t prevSibling{INVALID_ENTITY_ID};
+        size_t nextSibling{INVALID_ENTITY_ID};
+        size_t numChildren{0};
         
         void setParent(EntityHandle p, bool keepGlobalPosition = true);
         void clearParent(bool keepGlobalPosition = true);
         void addChild(EntityHandle child, bool keepGlobalPosition = true);
         void removeChild(EntityHandle child, bool keepGlobalPosition = true);
         
+        inline bool hasParent() const { return parent != INVALID_ENTITY_ID; }
+        EntityHandle getParent() const;
+        //direct children in the order they were added
+        Range<ChildIterator> getChildren() const;
+        //this graph followed by all of its descendants, depth first
+        Range<SubtreeIterator> getSubtree() const;
+        
+        //nullptr for INVALID_ENTITY_ID
+        static inline EntityGraph* find(SparseComponentStorage<EntityGraph>& graphs, size_t entity_id){
+            return entity_id != INVALID_ENTITY_ID ? graphs.get(entity_id) : nullptr;
+        }
+        
+    private:
+        
+        static SparseComponentStorage<EntityGraph>& getGraphs(Scene& scene);
+        void link(EntityGraph& newParent, bool keepGlobalPosition);
+        void unlink(bool keepGlobalPosition);
+        
+        friend Entity;
     };
     
-//    class GraphComponent {
-//    public:
-//        
-//        GraphComponent(EntityHandle self);
-//        ~GraphComponent();
-//        
-//        void setParent(EntityHandle p, bool keepGlobalPosition = true);
-//        void removeFromParent(bool keepGlobalPosition = true);
-//        void addChild(EntityHandle child, bool keepGlobalPosition = true);
-//        void removeChild(EntityHandle child, bool keepGlobalPosition = true);
-//        std::vector<EntityHandle> getChildren();
-//        std::vector<EntityHandle> filterChildren( const std::function<bool(Entity&)>& predicate );
-//        EntityHandle firstChild( const std::function<bool(Entity&)>& predicate );
-//
-//    private:
-//        
-//        EntityHandle findSiblingHead();
-//        EntityHandle findSiblingTail();
-//
-//        void removeFromSiblings();
-//        
-//        EntityHandle mSelf;
-//        EntityHandle mParent;
-//        EntityHandle mPrevSibling;
-//        EntityHandle mNextSibling;
-//        EntityHandle mChildHead;
-//    };
-    
     class Entity {
     public:
         
@@ -76,36 +129,36 @@ namespace mediasystem {
         bool destroy();
         void clearComponents();
         
-        inline bool isValid(){ return mId != std::numeric_limits<size_t>::max(); }
+        inline bool isValid(){ return mId != INVALID_ENTITY_ID; }
         inline size_t getId() const { return mId; }
         inline Scene& getScene(){ return mScene; }
         
         //convenience functions for working with components
         
         template<typename Component, typename...Args>
-        Handle<Component> createComponent(Args&&...args){
+        ComponentHandle<Component> createComponent(Args&&...args){
             
-            auto compId = getId<Component>();
+            auto compId = type_index<Component>();
             
-            if(mComponents[compId]){
+            if(mComponents.test(compId)){
                 mScene.destroyComponent<Component>(mId);
             }
             
             auto ret = mScene.createComponent<Component>(mId, std::forward<Args>(args)...);
 
             if(!ret.expired()){
-                mComponents[compId] = true;
+                mComponents.set(compId);
             }
             return ret;
         }
         
         template<typename Component>
         bool destroyComponent(){
-            auto compId = getId<Component>();
-            if(mComponents[compId]){
+            auto compId = type_index<Component>();
+            if(mComponents.test(compId)){
                 auto ret = mScene.destroyComponent<Component>(mId);
                 if(ret){
-                    mComponents[compId] = false;
+                    mComponents.reset(compId);
                 }
                 return ret;
             }else{
@@ -115,16 +168,19 @@ namespace mediasystem {
         
         template<typename Component>
         bool hasComponent(){
-            return mComponents[getId<Component>()];
+            return mComponents.test(type_index<Component>());
         }
         
+        inline const ComponentSignature& getSignature() const { return mComponents; }
+        
+        //a shared ptr or a raw pointer depending on HandleConfig.h, don't hold on to it
         template<typename Component>
-        StrongHandle<Component> getComponent() const{
+        ComponentStrongHandle<Component> getComponent() const{
             return mScene.getComponent<Component>(mId).lock();
         }
         
         template<typename Component>
-        Handle<Component> getComponentHandle() const{
+        ComponentHandle<Component> getComponentHandle() const{
             return mScene.getComponent<Component>(mId);
         }
         
@@ -134,7 +190,7 @@ namespace mediasystem {
         void clearParent(bool bMaintainGlobalTransform = false);
         void addChild(EntityHandle child);
         void removeChild(EntityHandle child);
-        EntityHandleList& getChildren();
+        EntityGraph::Range<EntityGraph::ChildIterator> getChildren();
         void removeChildren(bool keepGlobalPosition = true);
 
         //node component pass through
@@ -171,34 +227,17 @@ namespace mediasystem {
 
     private:
         
-        static std::map<type_id_t, size_t> sComponentIds;
-
-        template<typename ComponentType>
-        static size_t getId(){
-            auto found = sComponentIds.find(type_id<ComponentType>);
-            if(found != sComponentIds.end()){
-                return found->second;
-            }else{
-                auto typeID = type_id<ComponentType>;
-                auto flag = sNextComponentId++;
-                sComponentIds.insert({typeID, flag});
-                return flag;
-            }
-        }
-        
-        static type_id_t getType(size_t id){
-            for(auto& compId : sComponentIds){
-                if(compId.second == id)
-                    return compId.first;
-            }
-            return nullptr;
-        }
+        //marks the ofNode of this entity changed, which invalidates its cached transforms and those of its descendants
+        void markTransformDirty();
+        TransformSystem* getCachedTransforms() const;
+        //unparents the entity's node and its children's nodes before the components go away
+        void detachNodes();
         
-        static size_t sNextComponentId;
-        std::bitset<64> mComponents;
-        size_t mId{std::numeric_limits<size_t>::max()};
+        ComponentSignature mComponents;
+        size_t mId{INVALID_ENTITY_ID};
         Scene& mScene;
         friend Scene;
+        friend EntityGraph;
     };
     
 }//end namespace mediasystem
@@ -0,0 +1,34 @@
+//
+//  EntityId.h
+//  ofxMediaSystem
+//
+
+#pragma once
+
+#include <cstddef>
+#include <limits>
+
+namespace mediasystem {
+
+    //Entity ids are a slot index in the low half and a generation in the high half.
+    //The index is reused once an entity is destroyed, the generation is bumped each time it is,
+    //so a stale id never matches the entity that currently lives in its slot.
+    constexpr size_t ENTITY_INDEX_BITS = sizeof(size_t) * 4;
+    constexpr size_t ENTITY_INDEX_MASK = (size_t(1) << ENTITY_INDEX_BITS) - 1;
+    constexpr size_t INVALID_ENTITY_ID = std::numeric_limits<size_t>::max();
+    //the last index is never handed out so a valid id can't collide with INVALID_ENTITY_ID
+    constexpr size_t MAX_ENTITY_INDEX = ENTITY_INDEX_MASK - 1;
+
+    inline constexpr size_t makeEntityId(size_t index, size_t generation){
+        return (generation << ENTITY_INDEX_BITS) | (index & ENTITY_INDEX_MASK);
+    }
+
+    inline constexpr size_t getEntityIndex(size_t entity_id){
+        return entity_id & ENTITY_INDEX_MASK;
+    }
+
+    inline constexpr size_t getEntityGeneration(size_t entity_id){
+        return entity_id >> ENTITY_INDEX_BITS;
+    }
+
+}//end namespace mediasystem
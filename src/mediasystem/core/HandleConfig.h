@@ -0,0 +1,43 @@
+//
+//  HandleConfig.h
+//  ofxMediaSystem
+//
+
+#pragma once
+
+#include "Handle.h"
+
+//To switch components to generation checked handles comment in the define below, or define
+//MS_GENERATIONAL_COMPONENT_HANDLES for the whole project. Component handles then become a storage
+//pointer plus entity id that is validated on lock, there is no control block and no ref counting.
+//Locking hands back a raw pointer which is only good until the component is destroyed, so don't
+//hold on to it across frames or share it with other threads.
+
+//#if !defined(MS_GENERATIONAL_COMPONENT_HANDLES)
+//#define MS_GENERATIONAL_COMPONENT_HANDLES
+//#endif
+
+namespace mediasystem {
+
+    template<typename T>
+    class GenerationalHandle;
+
+#if defined(MS_GENERATIONAL_COMPONENT_HANDLES)
+
+    template<typename T>
+    using ComponentHandle = GenerationalHandle<T>;
+
+    template<typename T>
+    using ComponentStrongHandle = T*;
+
+#else
+
+    template<typename T>
+    using ComponentHandle = Handle<T>;
+
+    template<typename T>
+    using ComponentStrongHandle = StrongHandle<T>;
+
+#endif
+
+}//end namespace mediasystem
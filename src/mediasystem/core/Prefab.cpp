@@ -0,0 +1,81 @@
+//
+//  Prefab.cpp
+//  ofxMediaSystem
+//
+
+#include "Prefab.h"
+#include <unordered_map>
+
+namespace mediasystem {
+
+    std::vector<Entity*> Prefab::captureGraph(Entity& root)
+    {
+        mNodes.clear();
+        mComponents.clear();
+        std::vector<Entity*> entities;
+        auto graph = root.getComponent<EntityGraph>();
+        if(!graph)
+            return entities;
+        //parents precede their children, so the parent's node is looked up among the ones already captured
+        std::unordered_map<size_t, int32_t> indices;
+        for(auto & descendant : graph->getSubtree()){
+            auto entity = &descendant.self;
+            Node node;
+            if(&descendant != &*graph)
+                node.parent = indices[descendant.parent];
+            if(auto transform = entity->getComponent<ofNode>()){
+                node.position = transform->getPosition();
+                node.orientation = transform->getOrientationQuat();
+                node.scale = transform->getScale();
+            }
+            indices[entity->getId()] = int32_t(mNodes.size());
+            mNodes.push_back(node);
+            entities.push_back(entity);
+        }
+        return entities;
+    }
+
+    std::vector<size_t> Prefab::instantiate(Scene& scene, size_t count) const
+    {
+        std::vector<size_t> roots;
+        if(mNodes.empty() || count == 0)
+            return roots;
+
+        auto numNodes = mNodes.size();
+        auto ids = scene.spawnEntities(count * numNodes);
+        //out of entity ids, only keep whole copies
+        count = ids->size() / numNodes;
+        auto& entities = *ids;
+        for(auto i = count * numNodes; i < entities.size(); ++i){
+            scene.destroyEntity(entities[i]);
+        }
+
+        auto& transforms = scene.getStorage<ofNode>();
+        for(size_t copy = 0; copy < count; ++copy){
+            auto first = copy * numNodes;
+            for(size_t i = 0; i < numNodes; ++i){
+                auto& node = mNodes[i];
+                auto transform = transforms.get(entities[first + i]);
+                transform->setPosition(node.position);
+                transform->setOrientation(node.orientation);
+                transform->setScale(node.scale);
+            }
+        }
+
+        for(auto & components : mComponents){
+            components->instantiate(scene, entities, count, numNodes);
+        }
+
+        //parented last, nodes that move between archetype chunks while linked have to patch their relatives
+        roots.reserve(count);
+        for(size_t copy = 0; copy < count; ++copy){
+            auto first = copy * numNodes;
+            roots.push_back(entities[first]);
+            for(size_t i = 1; i < numNodes; ++i){
+                scene.getEntityRef(entities[first + i]).setParent(scene.getEntity(entities[first + mNodes[i].parent]), false);
+            }
+        }
+        return roots;
+    }
+
+}//end namespace mediasystem
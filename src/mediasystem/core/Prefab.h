@@ -0,0 +1,124 @@
+//
+//  Prefab.h
+//  ofxMediaSystem
+//
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <type_traits>
+#include "mediasystem/core/Scene.h"
+#include "mediasystem/core/Entity.h"
+
+namespace mediasystem {
+
+    //A captured entity subtree that can be stamped out many times. create copies the root, its
+    //EntityGraph descendants, their local transforms and every listed component type. instantiate
+    //spawns all copies in one go, component by component type into pre-reserved storage, and queues a
+    //single NewEntities plus one NewComponents<T> per type instead of events per entity.
+    //
+    //Components are copy constructed, which is a plain memcpy for trivially copyable types. Types that
+    //keep a reference to their entity are copied through T(Entity&, const T&) when they have it, see
+    //Drawable and InputComponent. Anything pointing at other components or entities of the template
+    //still points at the originals in the copies.
+    class Prefab {
+    public:
+
+        Prefab() = default;
+        Prefab(Prefab&&) = default;
+        Prefab& operator=(Prefab&&) = default;
+
+        //non copyable
+        Prefab(const Prefab&) = delete;
+        Prefab& operator=(const Prefab&) = delete;
+
+        //ofNode and EntityGraph are always captured and must not be listed
+        template<typename...ComponentTypes>
+        static Prefab create(Entity& root){
+            Prefab prefab;
+            auto entities = prefab.captureGraph(root);
+            int l[] = {0, (prefab.captureComponents<ComponentTypes>(entities),0)...};
+            UNUSED_VARIABLE(l);
+            return prefab;
+        }
+
+        //creates count copies in scene, which doesn't have to be the one the prefab was captured from,
+        //returns the id of every copy's root
+        std::vector<size_t> instantiate(Scene& scene, size_t count) const;
+
+        //entities per copy
+        inline size_t getNumEntities() const { return mNodes.size(); }
+        inline bool empty() const { return mNodes.empty(); }
+
+    private:
+
+        struct Node {
+            int32_t parent{-1}; //index into mNodes, parents precede their children
+            glm::vec3 position;
+            glm::quat orientation;
+            glm::vec3 scale{1.f};
+        };
+
+        class IComponents {
+        public:
+            virtual ~IComponents() = default;
+            //entities holds count copies of the subtree one after the other
+            virtual void instantiate(Scene& scene, const std::vector<size_t>& entities, size_t count, size_t numNodes) const = 0;
+        };
+
+        template<typename ComponentType>
+        class Components : public IComponents {
+        public:
+            void instantiate(Scene& scene, const std::vector<size_t>& entities, size_t count, size_t numNodes) const override {
+                Prefab::copyComponents(scene, entities, count, numNodes, nodes, prototypes);
+            }
+            std::vector<uint32_t> nodes; //which nodes have the component
+            std::vector<ComponentType> prototypes; //parallel to nodes
+        };
+
+        //subtree in depth first order, fills mNodes
+        std::vector<Entity*> captureGraph(Entity& root);
+
+        template<typename ComponentType>
+        void captureComponents(const std::vector<Entity*>& entities){
+            static_assert(!std::is_same<ComponentType, ofNode>::value && !std::is_same<ComponentType, EntityGraph>::value, "ofNode and EntityGraph are part of every prefab.");
+            std::unique_ptr<Components<ComponentType>> components(new Components<ComponentType>());
+            for(size_t i = 0; i < entities.size(); ++i){
+                if(auto component = entities[i]->getComponent<ComponentType>()){
+                    components->nodes.push_back(uint32_t(i));
+                    components->prototypes.push_back(*component);
+                }
+            }
+            if(!components->nodes.empty())
+                mComponents.push_back(std::move(components));
+        }
+
+        template<typename ComponentType>
+        static void copyComponents(Scene& scene, const std::vector<size_t>& entities, size_t count, size_t numNodes, const std::vector<uint32_t>& nodes, const std::vector<ComponentType>& prototypes){
+            auto& storage = scene.getStorage<ComponentType>();
+            storage.reserve(count * nodes.size());
+            auto ids = std::make_shared<std::vector<size_t>>();
+            ids->reserve(count * nodes.size());
+            std::vector<ComponentHandle<ComponentType>> handles;
+            handles.reserve(count * nodes.size());
+            for(size_t copy = 0; copy < count; ++copy){
+                auto first = copy * numNodes;
+                for(size_t i = 0; i < nodes.size(); ++i){
+                    auto id = entities[first + nodes[i]];
+                    if(scene.copyComponent(storage, id, prototypes[i], std::is_constructible<ComponentType, Entity&, const ComponentType&>())){
+                        scene.markComponent(id, type_index<ComponentType>());
+                        ids->push_back(id);
+                        handles.push_back(storage.getComponentHandle(id));
+                    }
+                }
+            }
+            scene.queueEvent<NewComponents<ComponentType>>(std::move(ids), std::move(handles));
+        }
+
+        std::vector<Node> mNodes;
+        std::vector<std::unique_ptr<IComponents>> mComponents;
+    };
+
+}//end namespace mediasystem
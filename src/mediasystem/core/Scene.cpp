@@ -1,32 +1,129 @@
 #include "Scene.h"
 #include "mediasystem/core/Entity.h"
+#include "mediasystem/core/TransformSystem.h"
 #include "mediasystem/util/Util.h"
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
 
 namespace mediasystem {
 
     Scene::Scene(const std::string & name, AllocationManager&& allocationManager):
+        Scene(name, ComponentStorageMode::PER_TYPE, std::move(allocationManager))
+    {}
+
+    Scene::Scene(const std::string & name, ComponentStorageMode mode, AllocationManager&& allocationManager):
         mName(name),
         mAllocationManager(std::move(allocationManager))
-    {}
+    {
+        if(mode == ComponentStorageMode::ARCHETYPE){
+#if defined(MS_GENERATIONAL_COMPONENT_HANDLES)
+            mArchetypes.reset(new ArchetypeStorage(&mAllocationManager));
+#else
+            //shared handles alias the component's address, which can't follow it between chunks
+            ofLogWarning("Scene") << "Scene: " << mName << " archetype storage needs MS_GENERATIONAL_COMPONENT_HANDLES, using per type storage.";
+#endif
+        }
+    }
 
     Scene::~Scene()
-    {}
-    
-    static size_t sNextEntityId = 0;
+    {
+        //queued events can hold component strongs, release them while the storages and allocators are still alive
+        clearQueues();
+        //queries probe every storage they observe, they can't be around while the storages are torn down
+        mQueries.clear();
+    }
     
     EntityHandle Scene::createEntity()
     {
-        auto next = sNextEntityId++;
-        auto it = mEntities.emplace(next, allocateStrongHandle<Entity>(Allocator<Entity>( &mAllocationManager ), *this, next));
-        if(it.second){
-            queueEvent<NewEntity>(it.first->second);
-            //everyone gets a node component, because why not
-            it.first->second->createComponent<ofNode>();
-            it.first->second->createComponent<EntityGraph>(*it.first->second);
-            return it.first->second;
-        }else{
+        auto id = spawnEntity();
+        if(id == INVALID_ENTITY_ID)
             return EntityHandle();
+        auto& entity = mEntities[getEntityIndex(id)];
+        queueEvent<NewEntity>(entity);
+        queueEvent<NewComponent<ofNode>>(entity, getStorage<ofNode>().getComponentHandle(id));
+        queueEvent<NewComponent<EntityGraph>>(entity, getStorage<EntityGraph>().getComponentHandle(id));
+        return entity;
+    }
+    
+    size_t Scene::spawnEntity()
+    {
+        size_t id;
+        if(!mFreeEntities.empty()){
+            auto index = mFreeEntities.front();
+            mFreeEntities.pop_front();
+            id = makeEntityId(index, getEntityGeneration(mEntityIds[index]) + 1);
+            mEntityIds[index] = id;
+        }else{
+            auto index = mEntities.size();
+            if(index > MAX_ENTITY_INDEX){
+                ofLogError("Scene") << ("Scene: Out of entity ids, cannot create entity.");
+                return INVALID_ENTITY_ID;
+            }
+            id = makeEntityId(index, 0);
+            mEntities.emplace_back();
+            mEntityIds.push_back(id);
+        }
+        auto& entity = mEntities[getEntityIndex(id)];
+        entity = allocateStrongHandle<Entity>(Allocator<Entity>( &mAllocationManager ), *this, id);
+        //everyone gets a node component, because why not
+        emplaceComponent(getStorage<ofNode>(), id, is_relocatable_component<ofNode>());
+        entity->mComponents.set(type_index<ofNode>());
+        emplaceComponent(getStorage<EntityGraph>(), id, is_relocatable_component<EntityGraph>(), *entity);
+        entity->mComponents.set(type_index<EntityGraph>());
+        return id;
+    }
+    
+    void Scene::reserveEntities(size_t count)
+    {
+        auto fresh = count > mFreeEntities.size() ? count - mFreeEntities.size() : 0;
+        mEntities.reserve(mEntities.size() + fresh);
+        mEntityIds.reserve(mEntityIds.size() + fresh);
+        if(!mAllocationManager.reservePool<Entity>(getNumEntities() + count))
+            ofLogVerbose("Scene") << "reserveEntities: entities are already in use, only the storage was reserved";
+        reserve<ofNode>(count);
+        reserve<EntityGraph>(count);
+    }
+    
+    std::shared_ptr<const std::vector<size_t>> Scene::spawnEntities(size_t count)
+    {
+        auto fresh = count > mFreeEntities.size() ? count - mFreeEntities.size() : 0;
+        mEntities.reserve(mEntities.size() + fresh);
+        mEntityIds.reserve(mEntityIds.size() + fresh);
+        getStorage<ofNode>().reserve(count);
+        getStorage<EntityGraph>().reserve(count);
+        
+        auto ids = std::make_shared<std::vector<size_t>>();
+        ids->reserve(count);
+        for(size_t i = 0; i < count; ++i){
+            auto id = spawnEntity();
+            if(id == INVALID_ENTITY_ID)
+                break;
+            ids->push_back(id);
+        }
+        
+        std::vector<ComponentHandle<ofNode>> nodes;
+        std::vector<ComponentHandle<EntityGraph>> graphs;
+        nodes.reserve(ids->size());
+        graphs.reserve(ids->size());
+        for(auto id : *ids){
+            nodes.push_back(getStorage<ofNode>().getComponentHandle(id));
+            graphs.push_back(getStorage<EntityGraph>().getComponentHandle(id));
         }
+        queueEvent<NewEntities>(*this, ids);
+        queueEvent<NewComponents<ofNode>>(ids, std::move(nodes));
+        queueEvent<NewComponents<EntityGraph>>(ids, std::move(graphs));
+        return ids;
+    }
+    
+    void Scene::markComponent(size_t entity_id, type_index_t type)
+    {
+        mEntities[getEntityIndex(entity_id)]->mComponents.set(type);
+    }
+    
+    void Scene::unmarkComponent(size_t entity_id, type_index_t type)
+    {
+        mEntities[getEntityIndex(entity_id)]->mComponents.reset(type);
     }
     
     void Scene::clearSystems(){
@@ -35,8 +132,7 @@ namespace mediasystem {
     
     bool Scene::destroyEntity(size_t id)
     {
-        auto found = mEntities.find(id);
-        if(found != mEntities.end()){
+        if(isAlive(id)){
             mDestroyedEntities.push_back(id);
             return true;
         }
@@ -44,34 +140,98 @@ namespace mediasystem {
     }
     
     void Scene::clearComponents(){
-        mComponents.clear();
+        if(mArchetypes)
+            mArchetypes->clear();
+        //the storages themselves live as long as the scene so generational handles never dangle
+        for(auto & storage : mComponents){
+            if(storage)
+                storage->clear();
+        }
     }
     
     bool Scene::destroyComponent(type_id_t type, size_t entity_id){
-        auto found = mComponents.find(type);
-        if(found != mComponents.end()){
-            auto foundComponent = found->second.find(entity_id);
-            if(foundComponent != found->second.end()){
-                found->second.erase(foundComponent);
-                return true;
-            }else{
-                ofLogError("Scene") << ("ComponentManager: Entity id: " + std::to_string(entity_id) + " DOES NOT HAVE COMPONENT");
-                return false;
-            }
+        return destroyComponent(type_index_from_id(type), entity_id);
+    }
+    
+    bool Scene::destroyComponent(type_index_t type, size_t entity_id){
+        auto storage = findStorage(type);
+        if(storage && (storage->isExternal() ? mArchetypes->remove(type, entity_id) : storage->remove(entity_id))){
+            return true;
         }
         ofLogError("Scene") << ("ComponentManager: Entity id: " + std::to_string(entity_id) + " DOES NOT HAVE COMPONENT");
         return false;
     }
     
+    void Scene::destroyComponents(size_t entity_id, const ComponentSignature& signature){
+        if(mArchetypes)
+            mArchetypes->removeAll(entity_id);
+        signature.forEach([this, entity_id](type_index_t type){
+            auto storage = findStorage(type);
+            if(storage && !storage->isExternal())
+                storage->remove(entity_id);
+        });
+    }
+    
     void Scene::collectEntities()
     {
-        for(size_t i = 0; i < mDestroyedEntities.size(); i++){
-            auto entId = mDestroyedEntities.front();
-            auto ent = mEntities[entId];
-            triggerEvent<DestroyEntity>(ent);
-            ent->clearComponents();
-            mEntities.erase(entId);
-            mDestroyedEntities.pop_front();
+        //destroy handlers may queue more entities, those still go out this frame
+        while(!mDestroyedEntities.empty()){
+            std::vector<size_t> batch(mDestroyedEntities.begin(), mDestroyedEntities.end());
+            mDestroyedEntities.clear();
+            //may have been queued more than once
+            std::sort(batch.begin(), batch.end());
+            batch.erase(std::unique(batch.begin(), batch.end()), batch.end());
+            batch.erase(std::remove_if(batch.begin(), batch.end(), [this](size_t id){ return !isAlive(id); }), batch.end());
+            if(batch.empty())
+                continue;
+            
+            auto ids = std::make_shared<const std::vector<size_t>>(std::move(batch));
+            triggerEvent<DestroyEntities>(*this, ids);
+            if(getNumDelegates<DestroyEntity>() > 0){
+                for(auto id : *ids){
+                    triggerEvent<DestroyEntity>(EntityHandle(mEntities[getEntityIndex(id)]));
+                }
+            }
+            releaseEntities(*ids);
+        }
+    }
+    
+    void Scene::releaseEntities(const std::vector<size_t>& ids)
+    {
+        for(auto id : ids){
+            getEntityRef(id).detachNodes();
+        }
+        if(mArchetypes){
+            for(auto id : ids){
+                mArchetypes->removeAll(id);
+            }
+        }
+        
+        //bucket the ids by component type so every storage is walked once
+        for(auto id : ids){
+            getEntityRef(id).mComponents.forEach([this, id](type_index_t type){
+                auto storage = findStorage(type);
+                if(!storage || storage->isExternal())
+                    return;
+                if(type >= mReleasedByType.size()){
+                    mReleasedByType.resize(type + 1);
+                }
+                mReleasedByType[type].push_back(id);
+            });
+        }
+        for(type_index_t type = 0; type < mReleasedByType.size(); ++type){
+            auto& bucket = mReleasedByType[type];
+            if(bucket.empty())
+                continue;
+            findStorage(type)->removeBatch(bucket);
+            bucket.clear();
+        }
+        
+        for(auto id : ids){
+            auto index = getEntityIndex(id);
+            mEntities[index]->mComponents.reset();
+            mEntities[index].reset();
+            mFreeEntities.push_back(index);
         }
     }
     
@@ -85,9 +245,8 @@ namespace mediasystem {
     
     EntityHandle Scene::getEntity(size_t id)
     {
-        auto found = mEntities.find(id);
-        if(found != mEntities.end()){
-            return EntityHandle(found->second);
+        if(isAlive(id)){
+            return EntityHandle(mEntities[getEntityIndex(id)]);
         }else{
             return EntityHandle();
         }
@@ -144,29 +303,72 @@ namespace mediasystem {
         notifyStop();
     }
     
+    SceneStats Scene::getStats() const
+    {
+        SceneStats stats;
+        stats.scene = mName;
+        stats.frame = mFrame;
+        stats.numEntities = getNumEntities();
+        stats.entityCapacity = mEntities.size();
+        for(auto & storage : mComponents){
+            if(!storage)
+                continue;
+            ComponentTypeStats component;
+            component.type = storage->getTypeIndex();
+            component.name = storage->getTypeName();
+            component.count = storage->size();
+            component.external = storage->isExternal();
+            component.memory = storage->getMemory();
+            stats.components.push_back(std::move(component));
+        }
+        if(mArchetypes){
+            stats.numArchetypes = mArchetypes->getNumArchetypes();
+            stats.numChunks = mArchetypes->getNumChunks();
+            stats.archetypes = mArchetypes->getMemory();
+        }
+        mAllocationManager.eachPolicy([&](const char* name, const IAllocationPolicy& policy){
+            stats.allocations.push_back(AllocationTypeStats{name, policy.getStats()});
+        });
+        stats.lastFrameLookups = mLastFrameLookups;
+        stats.frameLookups.lookups = mLookups.load(std::memory_order_relaxed);
+        stats.frameLookups.misses = mMisses.load(std::memory_order_relaxed);
+        stats.totalLookups.lookups = mTotalLookups.lookups + stats.frameLookups.lookups;
+        stats.totalLookups.misses = mTotalLookups.misses + stats.frameLookups.misses;
+        stats.update.dispatch = getDispatchTiming<Update>();
+        stats.update.delegates = getDelegateTimings<Update>();
+        stats.draw.dispatch = getDispatchTiming<Draw>();
+        stats.draw.delegates = getDelegateTimings<Draw>();
+        return stats;
+    }
+    
+    std::string Scene::dumpStats(const std::string& path) const
+    {
+        auto json = getStats().toJson();
+        if(path.empty())
+            return json;
+        auto file = std::fopen(path.c_str(), "wb");
+        if(!file){
+            ofLogError("Scene") << "Can't open " << path << " for writing stats.";
+            return json;
+        }
+        if(std::fwrite(json.data(), 1, json.size(), file) != json.size())
+            ofLogError("Scene") << "Failed writing stats to " << path;
+        std::fclose(file);
+        return json;
+    }
+    
     void Scene::notifyUpdate(size_t elapsedFrames, float elapsedTime, float prevFrameTime)
     {
+        mLastFrameLookups.lookups = mLookups.exchange(0, std::memory_order_relaxed);
+        mLastFrameLookups.misses = mMisses.exchange(0, std::memory_order_relaxed);
+        mTotalLookups.lookups += mLastFrameLookups.lookups;
+        mTotalLookups.misses += mLastFrameLookups.misses;
+        ++mFrame;
         mCurrentTime = elapsedTime;
         
-        if(!mStagedCues.empty())
-            mCues.splice(mCues.end(), mStagedCues);
-        
-        auto it = mCues.begin();
-        auto end = mCues.end();
-        while(it!=end){
-            auto & cue = *it;
-            if(elapsedTime >= cue.executionTime){
-                cue.handler();
-                if(cue.repeats){
-                    cue.executionTime += cue.interval;
-                    ++it;
-                }else{
-                    it = mCues.erase(it);
-                }
-            }else {
-                ++it;
-            }
-        }
+        applyCommands();
+        updateLoading();
+        mCues.update(elapsedTime);
         
         if(mIsTransitioning){
             auto perc = getPercentTransitionComplete();
@@ -186,10 +388,220 @@ namespace mediasystem {
         }
         mSequence.update(elapsedFrames,elapsedTime,prevFrameTime);
         update(elapsedFrames, elapsedTime, prevFrameTime);
-        triggerEvent<Update>(*this, elapsedFrames, elapsedTime, prevFrameTime);
+        //Update delegates and systems read cached world transforms
+        if(mTransforms)
+            mTransforms->update();
+        IEventRef event = std::make_shared<Update>(*this, elapsedFrames, elapsedTime, prevFrameTime);
+        //the delegates, scheduled systems and rated updates are one Update dispatch
+        auto profiler = findProfiler(type_id<Update>);
+        if(profiler && profiler->isEnabled())
+            profiler->beginDispatch();
+        triggerEvent(event);
+        mScheduler.run(event);
+        updateRated(elapsedFrames, elapsedTime, prevFrameTime);
+        if(profiler)
+            profiler->endDispatch();
         //process any events queued by other systems and components, etc.
         processEvents();
         collectEntities();
+        flushLifecycleBatches();
+    }
+    
+    void Scene::markTransformDirty(size_t entity_id)
+    {
+        mTransforms->markDirty(entity_id);
+    }
+    
+    void Scene::onProfilerCreated(type_id_t type, DelegateProfiler& profiler)
+    {
+        if(type == type_id<Update>)
+            mScheduler.setProfiler(&profiler, this);
+    }
+    
+    void Scene::addUpdateDelegate(EventDelegate delegate, const UpdateRate& rate, const std::string& name)
+    {
+        if(rate.type == UpdateRate::EVERY_FRAME){
+            addDelegate<Update>(std::move(delegate), name);
+            return;
+        }
+        if(!name.empty())
+            setDelegateName<Update>(delegate, name);
+        RatedUpdate rated;
+        rated.delegate = std::move(delegate);
+        rated.rate = rate;
+        if(rate.staggered){
+            //the least used phase of the tier, fixed rates are spread over quarters of their period
+            std::vector<size_t> used(rate.type == UpdateRate::EVERY_NTH_FRAME ? rate.frames : 4, 0);
+            for(auto & other : mRatedUpdates){
+                if(other.delegate.isNull() || other.rate.type != rate.type)
+                    continue;
+                if(rate.type == UpdateRate::EVERY_NTH_FRAME && other.rate.frames == rate.frames)
+                    ++used[other.rate.framePhase];
+                else if(rate.type == UpdateRate::FIXED_HZ && other.rate.period == rate.period)
+                    ++used[static_cast<size_t>(std::round(other.rate.timePhase / rate.period * used.size())) % used.size()];
+            }
+            auto phase = static_cast<size_t>(std::min_element(used.begin(), used.end()) - used.begin());
+            rated.rate.framePhase = phase;
+            rated.rate.timePhase = rate.period * phase / used.size();
+        }
+        if(rated.rate.type == UpdateRate::FIXED_HZ){
+            //the first point on the tier's grid after now
+            auto period = static_cast<double>(rated.rate.period);
+            rated.nextTime = (std::floor((mCurrentTime - rated.rate.timePhase) / period) + 1.) * period + rated.rate.timePhase;
+        }
+        mRatedUpdates.push_back(std::move(rated));
+    }
+    
+    void Scene::removeUpdateDelegate(const EventDelegate& delegate)
+    {
+        auto found = std::find_if(mRatedUpdates.begin(), mRatedUpdates.end(), [&](const RatedUpdate& rated){
+            return rated.delegate == delegate;
+        });
+        if(found == mRatedUpdates.end()){
+            removeDelegate<Update>(delegate);
+            return;
+        }
+        forgetDelegate(type_id<Update>, delegate);
+        if(mUpdatingRated)
+            found->delegate = EventDelegate();
+        else
+            mRatedUpdates.erase(found);
+    }
+    
+    bool Scene::isDue(RatedUpdate& rated, float elapsedTime)
+    {
+        if(rated.rate.type == UpdateRate::EVERY_NTH_FRAME)
+            return mFrame % rated.rate.frames == rated.rate.framePhase;
+        //frame times don't fall exactly on the grid
+        static const double tolerance = 1e-4;
+        if(elapsedTime + tolerance < rated.nextTime)
+            return false;
+        //after a hitch the next run stays on the grid rather than catching up
+        while(rated.nextTime <= elapsedTime + tolerance)
+            rated.nextTime += rated.rate.period;
+        return true;
+    }
+    
+    void Scene::updateRated(size_t elapsedFrames, float elapsedTime, float prevFrameTime)
+    {
+        if(mRatedUpdates.empty())
+            return;
+        mUpdatingRated = true;
+        //by index, a delegate may add another
+        for(size_t i = 0; i < mRatedUpdates.size(); ++i){
+            auto& rated = mRatedUpdates[i];
+            if(rated.delegate.isNull() || !isDue(rated, elapsedTime))
+                continue;
+            auto sinceLastRun = rated.hasRun ? elapsedTime - rated.lastTime : prevFrameTime;
+            rated.lastTime = elapsedTime;
+            rated.hasRun = true;
+            auto delegate = rated.delegate;
+            auto status = invoke(delegate, std::make_shared<Update>(*this, elapsedFrames, elapsedTime, sinceLastRun));
+            if(status == EventStatus::REMOVE_THIS_DELEGATE){
+                forgetDelegate(type_id<Update>, delegate);
+                mRatedUpdates[i].delegate = EventDelegate();
+            }
+        }
+        mUpdatingRated = false;
+        mRatedUpdates.erase(std::remove_if(mRatedUpdates.begin(), mRatedUpdates.end(), [](const RatedUpdate& rated){
+            return rated.delegate.isNull();
+        }), mRatedUpdates.end());
+    }
+    
+    void Scene::addLoadStep(LoadStep step)
+    {
+        if(!step)
+            return;
+        if(mLoadSteps.empty() && mNumLoadSteps == 0)
+            mLoadStart = std::chrono::steady_clock::now();
+        PendingLoad load;
+        load.resumable = std::move(step);
+        mLoadSteps.emplace_back(std::move(load));
+        ++mNumLoadSteps;
+    }
+    
+    void Scene::addLoadSteps(size_t count, std::function<void(size_t)> step)
+    {
+        if(!count || !step)
+            return;
+        if(mLoadSteps.empty() && mNumLoadSteps == 0)
+            mLoadStart = std::chrono::steady_clock::now();
+        PendingLoad load;
+        load.each = std::move(step);
+        load.count = count;
+        mLoadSteps.emplace_back(std::move(load));
+        mNumLoadSteps += count;
+    }
+    
+    bool Scene::updateLoading()
+    {
+        if(mLoadSteps.empty())
+            return true;
+        auto start = std::chrono::steady_clock::now();
+        auto budget = std::chrono::duration<float, std::milli>(mLoadBudget);
+        do{
+            //references into a deque survive steps queueing more steps
+            auto& load = mLoadSteps.front();
+            bool finished;
+            if(load.each){
+                load.each(load.next++);
+                ++mNumLoadedSteps;
+                finished = load.next >= load.count;
+            }else{
+                finished = load.resumable();
+                if(finished)
+                    ++mNumLoadedSteps;
+            }
+            if(finished)
+                mLoadSteps.pop_front();
+        }while(!mLoadSteps.empty() && std::chrono::steady_clock::now() - start < budget);
+        
+        if(!mLoadSteps.empty())
+            return false;
+        auto seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - mLoadStart).count();
+        auto steps = mNumLoadSteps;
+        mNumLoadSteps = 0;
+        mNumLoadedSteps = 0;
+        triggerEvent<LoadComplete>(*this, steps, seconds);
+        return true;
+    }
+    
+    void Scene::submit(CommandBuffer&& commands)
+    {
+        if(commands.empty() && !commands.mOnApplied)
+            return;
+        std::lock_guard<std::mutex> lock(mCommandsMutex);
+        mPendingCommands.emplace_back(std::move(commands));
+    }
+    
+    size_t Scene::getNumPendingCommands()
+    {
+        std::lock_guard<std::mutex> lock(mCommandsMutex);
+        return mPendingCommands.size();
+    }
+    
+    void Scene::applyCommands()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mCommandsMutex);
+            if(mPendingCommands.empty())
+                return;
+            std::swap(mPendingCommands, mApplyingCommands);
+        }
+        //buffers submitted while these are applied wait for the next update
+        for(auto & commands : mApplyingCommands){
+            commands.apply(*this);
+        }
+        mApplyingCommands.clear();
+    }
+    
+    void Scene::flushLifecycleBatches()
+    {
+        //by index, batch observers may create storages
+        for(size_t type = 0; type < mComponents.size(); ++type){
+            if(auto storage = mComponents[type].get())
+                storage->flushBatches();
+        }
     }
     
     void Scene::notifyStart()
@@ -201,7 +613,6 @@ namespace mediasystem {
 
     void Scene::notifyStop()
     {
-        mStagedCues.clear();
         mCues.clear();
         mHasStarted = false;
         mIsTransitioning = false;
@@ -246,18 +657,36 @@ namespace mediasystem {
     
     void Scene::notifyShutdown()
     {
-        mStagedCues.clear();
         mCues.clear();
+        mLoadSteps.clear();
+        mNumLoadSteps = 0;
+        mNumLoadedSteps = 0;
+        {
+            std::lock_guard<std::mutex> lock(mCommandsMutex);
+            mPendingCommands.clear();
+        }
         shutdown();
         triggerEvent<Shutdown>(*this);
+        std::vector<size_t> ids;
+        ids.reserve(getNumEntities());
         for(auto & ent : mEntities){
-            ent.second->clearComponents();
+            if(ent)
+                ids.push_back(ent->getId());
         }
+        releaseEntities(ids);
         clearComponents();
-        mEntities.clear();
+        //keep the generations so ids from before the shutdown stay stale
+        mFreeEntities.clear();
+        for(size_t index = 0; index < mEntities.size(); ++index){
+            mEntities[index].reset();
+            mFreeEntities.push_back(index);
+        }
+        mDestroyedEntities.clear();
         clearSystems();
+        mScheduler.clear();
         clearQueues();
         clearDelegates();
+        mRatedUpdates.clear();
     }
     
     void Scene::notifyDraw()
@@ -287,67 +716,32 @@ namespace mediasystem {
         mSequence.requestState(std::move(state));
     }
 
-    static size_t sCueIds = 0;
-    
     CueId Scene::cueAtTime(float seconds, std::function<void()> handler)
     {
         if(seconds > mCurrentTime){
-            auto id = sCueIds++;
-            Cue c;
-            c.interval = seconds;
-            c.executionTime = mCurrentTime + seconds;
-            c.handler = std::move(handler);
-            c.id = id;
-            mStagedCues.emplace_back(std::move(c));
-            return id;
+            return mCues.add(seconds, 0.f, false, std::move(handler));
         }
         
         ofLogError("Scene") << "Could not create a cue at time: " << seconds << " that has already passed, current time: " << mCurrentTime;
         
-        return -1;
+        return INVALID_CUE_ID;
     }
     
     CueId Scene::cueFromNow(float seconds, std::function<void()> handler)
     {
-        auto id = sCueIds++;
-        Cue c;
-        c.interval = seconds;
-        c.executionTime = mCurrentTime + seconds;
-        c.handler = std::move(handler);
-        c.id = id;
-        mStagedCues.emplace_back(std::move(c));
-        return id;
+        return mCues.add(mCurrentTime + seconds, 0.f, false, std::move(handler));
     }
     
     CueId Scene::cueInterval(float seconds, std::function<void()> handler)
     {
-        auto id = sCueIds++;
-        Cue c;
-        c.interval = seconds;
-        c.executionTime = mCurrentTime + seconds;
-        c.handler = std::move(handler);
-        c.id = id;
-        mStagedCues.emplace_back(std::move(c));
-        return id;
+        return mCues.add(mCurrentTime + seconds, seconds, true, std::move(handler));
     }
     
     void Scene::cancelCue(CueId id)
     {
-        auto found = std::find_if(mCues.begin(), mCues.end(), [id](const Cue& cue){
-            return cue.id == id;
-        });
-        if(found!=mCues.end()){
-            mCues.erase(found);
-            return;
-        }
-        found = std::find_if(mStagedCues.begin(), mStagedCues.end(), [id](const Cue& cue){
-            return cue.id == id;
-        });
-        if(found!=mStagedCues.end()){
-            mStagedCues.erase(found);
-            return;
+        if(!mCues.cancel(id)){
+            ofLogWarning("Scene") << "There is no Cue for id: " << id;
         }
-        ofLogWarning("Scene") << "There is no Cue for id: " << id;
     }
     
 }//end namespace mediasystem
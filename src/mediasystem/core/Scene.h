@@ -1,57 +1,80 @@
 #pragma once
 #include <string>
 #include <map>
+#include <atomic>
+#include <mutex>
+#include <deque>
+#include <chrono>
 #include "ofMain.h"
 #include "mediasystem/events/EventManager.h"
 #include "mediasystem/events/SceneEvents.h"
 #include "mediasystem/util/StateMachine.h"
 #include "mediasystem/core/Handle.h"
+#include "mediasystem/core/EntityId.h"
 #include "mediasystem/memory/Memory.h"
+#include "mediasystem/core/ComponentStorage.h"
+#include "mediasystem/core/ArchetypeStorage.h"
+#include "mediasystem/core/ComponentView.h"
+#include "mediasystem/core/ComponentQuery.h"
+#include "mediasystem/core/SystemScheduler.h"
+#include "mediasystem/core/SceneStats.h"
+#include "mediasystem/core/CueScheduler.h"
+#include "mediasystem/core/CommandBuffer.h"
 
 namespace mediasystem {
     
-    using CueId = size_t;
     class Entity;
+    struct EntityGraph;
+    class TransformSystem;
     using EntityStrongHandle = StrongHandle<Entity>;
     using EntityHandle = Handle<Entity>;
     class Scene;
     
-    namespace detail {
-        using GenericStrongHandle = StrongHandle<void>;
-        using GenericStrongHandleAllocator = Allocator<std::pair<const size_t, GenericStrongHandle>>;
-    }
-    
-    using GenericComponentMap = std::map<size_t, detail::GenericStrongHandle, std::less<size_t>, detail::GenericStrongHandleAllocator>;
-    
     //adapter class
     template<typename ComponentType>
     class ComponentMap {
     public:
         
+        using Storage = SparseComponentStorage<ComponentType>;
+        using range_iterator = typename Storage::iterator;
+        
         ComponentMap() = default;
         
         class iterator {
         public:
-            StrongHandle<ComponentType> next(){
-                if(mIt == mEnd)
+            ComponentStrongHandle<ComponentType> next(){
+                if(!mComponents)
+                    return nullptr;
+                mSlot = mComponents->nextSlot(mSlot);
+                if(mSlot >= mComponents->getNumSlots())
                     return nullptr;
-                return staticCast<ComponentType>((*mIt++).second);
+                return mComponents->getStrongHandle(mComponents->getEntityId(mSlot++));
             }
         private:
             iterator() = default;
-            iterator( GenericComponentMap::iterator begin, GenericComponentMap::iterator end ):mIt(begin),mEnd(end){}
-            GenericComponentMap::iterator mIt;
-            GenericComponentMap::iterator mEnd;
+            iterator( Storage* components ):mComponents(components){}
+            Storage* mComponents{nullptr};
+            size_t mSlot{0};
             friend ComponentMap;
         };
         
-        iterator iter(){ return mComponents ? iterator(mComponents->begin(), mComponents->end()) : iterator(); }
+        iterator iter(){ return iterator(mComponents); }
         size_t size() const { return mComponents ? mComponents->size() : 0; }
         bool empty() const { return mComponents ? mComponents->empty() : true; }
+
+        //nullptr if the entity doesn't have one, no handle is created or locked.
+        //Don't hold on to the pointer, archetype storage moves components on structural changes.
+        ComponentType* get(size_t entity_id){ return mComponents ? mComponents->get(entity_id) : nullptr; }
+        //with shared handles keeps the component alive while it's held, even if it is removed meanwhile
+        ComponentStrongHandle<ComponentType> getStrongHandle(size_t entity_id){ return mComponents ? mComponents->getStrongHandle(entity_id) : nullptr; }
+
+        //contiguous iteration by reference, no handles are created or locked
+        range_iterator begin(){ return mComponents ? mComponents->begin() : range_iterator(); }
+        range_iterator end(){ return mComponents ? mComponents->end() : range_iterator(); }
         
     private:
-        ComponentMap(GenericComponentMap* components):mComponents(components){}
-        GenericComponentMap* mComponents{nullptr};
+        ComponentMap(Storage* components):mComponents(components){}
+        Storage* mComponents{nullptr};
         friend Scene;
     };
     
@@ -66,6 +89,13 @@ namespace mediasystem {
         virtual ~Scene();
         
         Scene(const std::string& name, AllocationManager&& allocationManager = AllocationManager());
+        //ComponentStorageMode::ARCHETYPE packs entities with the same components into shared chunks, which
+        //suits lots of uniform entities that are iterated every frame. It needs MS_GENERATIONAL_COMPONENT_HANDLES,
+        //without it the scene logs a warning and uses per type storage. Components are moved when their entity
+        //gains or loses a component, so nothing may keep a raw pointer to one across structural changes.
+        //ofNode's move constructor fixes up its parent and children. Types that must not move can opt out
+        //through is_relocatable_component.
+        Scene(const std::string& name, ComponentStorageMode mode, AllocationManager&& allocationManager = AllocationManager());
         
         //non copyable
         Scene(const Scene&) = delete;
@@ -86,9 +116,50 @@ namespace mediasystem {
         inline const std::string& getName() const { return mName; }
         
         virtual EntityHandle createEntity();
+        //Creates count entities in one go, each gets a copy of every prototype on top of the usual ofNode
+        //and EntityGraph. Storage is reserved once and a single NewEntities plus one NewComponents<T> per
+        //component type are queued instead of events per entity. Types that keep a reference to their
+        //entity are copied through T(Entity&, const T&) when they have it, see Drawable.
+        template<typename...ComponentTypes>
+        std::vector<size_t> createEntities(size_t count, const ComponentTypes&...prototypes){
+            auto ids = spawnEntities(count);
+            int l[] = {0, (copyComponents(ids, prototypes),0)...};
+            UNUSED_VARIABLE(l);
+            return *ids;
+        }
+        //Capacity hints, ie. before loading content. Call them before the first ComponentType is created.
+        //Room is made for count more components, their pages are written once so they're resident, and
+        //with shared handles the handles' control blocks come from a pool of count. After that creating and
+        //destroying up to count of them doesn't go to the system allocator, events aside. In an archetype
+        //scene the objects live in the archetype's chunks and only the index is reserved.
+        template<typename ComponentType>
+        void reserve(size_t count){
+            auto& storage = getStorage<ComponentType>();
+            storage.reserve(count);
+#if !defined(MS_GENERATIONAL_COMPONENT_HANDLES)
+            if(storage.isExternal())
+                return;
+            if(!mAllocationManager.reservePool<ComponentType>(storage.size() + count))
+                ofLogVerbose("Scene") << "reserve: " << typeid(ComponentType).name() << " handles are already in use, only the storage was reserved";
+#endif
+        }
+        //the same for count more entities along with their ofNode and EntityGraph
+        void reserveEntities(size_t count);
         virtual bool destroyEntity(size_t id);
         virtual bool destroyEntity(EntityHandle handle);
         virtual EntityHandle getEntity(size_t id);
+        //true if id refers to a live entity, stale ids from destroyed entities return false
+        inline bool isAlive(size_t id) const {
+            auto index = getEntityIndex(id);
+            return index < mEntityIds.size() && mEntityIds[index] == id && mEntities[index];
+        }
+        inline size_t getNumEntities() const { return mEntities.size() - mFreeEntities.size(); }
+        //nullptr unless a TransformSystem was created for this scene
+        inline TransformSystem* getTransformSystem() const { return mTransforms; }
+        //systems registered here run after the Update delegates, concurrently when they don't conflict. They
+        //are profiled with the Update delegates under their scheduled name, and the Update dispatch timing
+        //covers the delegates, the scheduled systems and the rated updates.
+        inline SystemScheduler& getScheduler(){ return mScheduler; }
 
         template<typename SystemType, typename...Args>
         StrongHandle<SystemType> createSystem(Args&&...args){
@@ -133,105 +204,198 @@ namespace mediasystem {
         }
         
         template<typename ComponentType, typename...Args>
-        Handle<ComponentType> createComponent(size_t entity_id, Args&&...args){
-            auto shared = allocateStrongHandle<ComponentType>( getAllocator<ComponentType>(), std::forward<Args>(args)...);
-            auto generic = staticCast<void>(shared);
-            auto found = mComponents.find(type_id<ComponentType>);
-            if(found != mComponents.end()){
-                auto it = found->second.emplace( entity_id, std::move(generic) );
-                if(it.second){
-                    queueEvent<NewComponent<ComponentType>>(getEntity(entity_id), shared);
-                    return shared;
-                }else{
-                    ofLogError("Scene") << ("ComponentManager: Entity id: " + std::to_string(entity_id) + " COULD NOT CREATE COMPONENT");
-                    return Handle<ComponentType>();
-                }
+        ComponentHandle<ComponentType> createComponent(size_t entity_id, Args&&...args){
+            auto& storage = getStorage<ComponentType>();
+            if(emplaceComponent(storage, entity_id, is_relocatable_component<ComponentType>(), std::forward<Args>(args)...)){
+                auto handle = storage.getComponentHandle(entity_id);
+                queueEvent<NewComponent<ComponentType>>(getEntity(entity_id), handle);
+                return handle;
             }else{
-                auto it = mComponents.emplace(type_id<ComponentType>, GenericComponentMap( getAllocator<std::pair<const size_t, detail::GenericStrongHandle>>() ));
-                if(it.second){
-                    auto res = it.first->second.emplace(entity_id, std::move(generic));
-                    if(res.second){
-                        queueEvent<NewComponent<ComponentType>>( getEntity(entity_id), shared);
-                        return shared;
-                    }else{
-                        ofLogError("Scene") << ("ComponentManager: Entity id: " + std::to_string(entity_id) + " COULD NOT CREATE COMPONENT");
-                        return Handle<ComponentType>();
-                    }
-                }else{
-                    ofLogError("Scene") << ("ComponentManager: COULD NOT CREATE GENERIC COMPONENT MAP FOR COMPONENT TYPE");
-                    return Handle<ComponentType>();
-                }
+                ofLogError("Scene") << ("ComponentManager: Entity id: " + std::to_string(entity_id) + " COULD NOT CREATE COMPONENT");
+                return ComponentHandle<ComponentType>();
             }
         }
         
+        //Misses are counted, see getStats, and only logged verbosely since this doubles as the check
+        //for whether an entity has a component.
         template<typename ComponentType>
-        Handle<ComponentType> getComponent(size_t entity_id){
-            auto found = mComponents.find(type_id<ComponentType>);
-            if(found != mComponents.end()){
-                auto foundComp = found->second.find(entity_id);
-                if(foundComp != found->second.end()){
-                    return staticCast<ComponentType>(foundComp->second);
-                }else{
-                    ofLogError("Scene") << ("ComponentManager: Entity id: " + std::to_string(entity_id) + " DOES NOT HAVE COMPONENT");
-                    return Handle<ComponentType>();
-                }
-            }else{
-                ofLogError("Scene") << ("ComponentManager: Entity id: " + std::to_string(entity_id) + " DOES NOT HAVE COMPONENT");
-                return Handle<ComponentType>();
+        ComponentHandle<ComponentType> getComponent(size_t entity_id){
+            countLookup();
+            auto storage = static_cast<SparseComponentStorage<ComponentType>*>(findStorage(type_index<ComponentType>()));
+            if(storage && storage->has(entity_id)){
+                return storage->getComponentHandle(entity_id);
             }
+            countMiss(entity_id);
+            return ComponentHandle<ComponentType>();
         }
         
-        Handle<void> getComponent(type_id_t type, size_t entity_id){
-            auto found = mComponents.find(type);
-            if(found != mComponents.end()){
-                auto foundComp = found->second.find(entity_id);
-                if(foundComp != found->second.end()){
-                    return foundComp->second;
-                }else{
-                    ofLogError("Scene") << ("ComponentManager: Entity id: " + std::to_string(entity_id) + " DOES NOT HAVE COMPONENT");
-                    return Handle<void>();
-                }
-            }else{
-                ofLogError("Scene") << ("ComponentManager: Entity id: " + std::to_string(entity_id) + " DOES NOT HAVE COMPONENT");
-                return Handle<void>();
+        ComponentHandle<void> getComponent(type_id_t type, size_t entity_id){
+            return getComponent(type_index_from_id(type), entity_id);
+        }
+        
+        ComponentHandle<void> getComponent(type_index_t type, size_t entity_id){
+            countLookup();
+            auto storage = findStorage(type);
+            if(storage && storage->has(entity_id)){
+#if defined(MS_GENERATIONAL_COMPONENT_HANDLES)
+                return ComponentHandle<void>(storage, entity_id);
+#else
+                return storage->getHandle(entity_id);
+#endif
             }
+            countMiss(entity_id);
+            return ComponentHandle<void>();
+        }
+        
+        //Lifecycle observers, called directly rather than through queued events. An immediate observer
+        //gets (entity_id, component) right after a ComponentType is constructed or right before one is
+        //destroyed, while it is still intact, whichever way it is created or removed. Keep a handle
+        //rather than the reference, components in an archetype scene move. A batch observer gets the
+        //ids once per update, at the end of notifyUpdate, which makes it the safe choice for systems
+        //that can't have their containers change while they walk them. Constructed ids are only
+        //passed on while the entity still has the component.
+        template<typename ComponentType>
+        void onConstruct(const ComponentObserver<ComponentType>& observer){
+            getStorage<ComponentType>().addLifecycleObserver(ComponentLifecycle::CONSTRUCT, observer);
+        }
+        
+        template<typename ComponentType>
+        void onConstruct(const ComponentBatchObserver& observer){
+            getStorage<ComponentType>().addBatchObserver(ComponentLifecycle::CONSTRUCT, observer);
+        }
+        
+        template<typename ComponentType>
+        void onDestroy(const ComponentObserver<ComponentType>& observer){
+            getStorage<ComponentType>().addLifecycleObserver(ComponentLifecycle::DESTROY, observer);
+        }
+        
+        template<typename ComponentType>
+        void onDestroy(const ComponentBatchObserver& observer){
+            getStorage<ComponentType>().addBatchObserver(ComponentLifecycle::DESTROY, observer);
+        }
+        
+        template<typename ComponentType>
+        bool removeOnConstruct(const ComponentObserver<ComponentType>& observer){
+            return getStorage<ComponentType>().removeLifecycleObserver(ComponentLifecycle::CONSTRUCT, observer);
+        }
+        
+        template<typename ComponentType>
+        bool removeOnConstruct(const ComponentBatchObserver& observer){
+            return getStorage<ComponentType>().removeBatchObserver(ComponentLifecycle::CONSTRUCT, observer);
+        }
+        
+        template<typename ComponentType>
+        bool removeOnDestroy(const ComponentObserver<ComponentType>& observer){
+            return getStorage<ComponentType>().removeLifecycleObserver(ComponentLifecycle::DESTROY, observer);
+        }
+        
+        template<typename ComponentType>
+        bool removeOnDestroy(const ComponentBatchObserver& observer){
+            return getStorage<ComponentType>().removeBatchObserver(ComponentLifecycle::DESTROY, observer);
         }
         
         template<typename ComponentType>
         bool destroyComponent(size_t entity_id){
-            auto found = mComponents.find(type_id<ComponentType>);
-            if(found != mComponents.end()){
-                auto foundComp = found->second.find(entity_id);
-                if(foundComp != found->second.end()){
-                    found->second.erase(foundComp);
-                    return true;
-                }else{
-                    ofLogError("Scene") << ("ComponentManager: Entity id: " + std::to_string(entity_id) + " DOES NOT HAVE COMPONENT");
-                    return false;
-                }
-            }else{
-                ofLogError("Scene") << ("ComponentManager: Entity id: " + std::to_string(entity_id) + " DOES NOT HAVE COMPONENT");
-                return false;
-            }
+            return destroyComponent(type_index<ComponentType>(), entity_id);
         }
         
         bool destroyComponent(type_id_t type, size_t entity_id);
+        bool destroyComponent(type_index_t type, size_t entity_id);
+        //destroys every component in signature, in an archetype scene the entity's row is dropped in one go
+        void destroyComponents(size_t entity_id, const ComponentSignature& signature);
         
         template<typename ComponentType>
         ComponentMap<ComponentType> getComponents(){
-            auto found = mComponents.find(type_id<ComponentType>);
-            if(found != mComponents.end()){
-                return ComponentMap<ComponentType>(&found->second);
-            }
-            auto it = mComponents.emplace(type_id<ComponentType>, GenericComponentMap( getAllocator<std::pair<const size_t, detail::GenericStrongHandle>>() ));
-            if(it.second){
-                return ComponentMap<ComponentType>(&it.first->second);
-            }else{
-                ofLogError("Scene") << ("ComponentManager: COULD NOT CREATE GENERIC COMPONENT MAP FOR COMPONENT TYPE");
-                return ComponentMap<ComponentType>();
+            return ComponentMap<ComponentType>(&getStorage<ComponentType>());
+        }
+        
+        //entities that have all of ComponentTypes, ie. scene.view<Drawable<ofImage>,ofNode>().each(...)
+        template<typename...ComponentTypes>
+        ComponentView<ComponentTypes...> view(){
+            return view<ComponentTypes...>(Exclude<>());
+        }
+        
+        //entities that have all of ComponentTypes and none of ExcludedTypes
+        template<typename...ComponentTypes, typename...ExcludedTypes>
+        ComponentView<ComponentTypes...> view(Exclude<ExcludedTypes...>){
+            return ComponentView<ComponentTypes...>(
+                std::make_tuple(&getStorage<ComponentTypes>()...),
+                std::vector<IComponentStorage*>{ static_cast<IComponentStorage*>(&getStorage<ExcludedTypes>())... },
+                mArchetypes.get()
+            );
+        }
+        
+        //Like view but persistent, the matching entities are tracked as components come and go so systems
+        //that walk the same filter every frame don't redo it. The scene owns the query and hands out the
+        //same one for the same types, hold on to the reference.
+        template<typename...ComponentTypes>
+        ComponentQuery<ComponentTypes...>& query(){
+            return query<ComponentTypes...>(Exclude<>());
+        }
+        
+        template<typename...ComponentTypes, typename...ExcludedTypes>
+        ComponentQuery<ComponentTypes...>& query(Exclude<ExcludedTypes...>){
+            ComponentSignature excluded;
+            int l[] = {0, (excluded.set(type_index<ExcludedTypes>()),0)...};
+            UNUSED_VARIABLE(l);
+            for(auto & query : mQueries){
+                if(query->mType == type_id<ComponentQuery<ComponentTypes...>> && query->mExcludeSignature == excluded)
+                    return *static_cast<ComponentQuery<ComponentTypes...>*>(query.get());
             }
+            auto query = new ComponentQuery<ComponentTypes...>(
+                std::make_tuple(&getStorage<ComponentTypes>()...),
+                std::vector<IComponentStorage*>{ static_cast<IComponentStorage*>(&getStorage<ExcludedTypes>())... }
+            );
+            mQueries.emplace_back(query);
+            return *query;
+        }
+        
+        //number of updates the scene has run, components added or marked changed are stamped with it
+        inline uint64_t getFrame() const { return mFrame; }
+        
+        //Flags the entity's component as changed this frame. Call it after modifying a component that
+        //other systems only revisit when it changes, Entity's transform setters do it for ofNode. An
+        //ofNode marked changed is also recomputed by the TransformSystem, with its descendants.
+        template<typename ComponentType>
+        bool markChanged(size_t entity_id){
+            auto storage = findStorage(type_index<ComponentType>());
+            if(!storage || !storage->markChanged(entity_id))
+                return false;
+            if(mTransforms && type_index<ComponentType>() == type_index<ofNode>())
+                markTransformDirty(entity_id);
+            return true;
+        }
+        
+        //frame the component was added or last marked changed, NO_CHANGE_FRAME if the entity has none
+        template<typename ComponentType>
+        uint64_t getChangeFrame(size_t entity_id){
+            auto storage = findStorage(type_index<ComponentType>());
+            return storage ? storage->getVersion(entity_id) : NO_CHANGE_FRAME;
         }
         
+        //Calls fn(entity_id, component) for every ComponentType added or marked changed in frame `since` or
+        //later. Keep getFrame() from before the call and pass it next time, the frame is included so nothing
+        //changed later in it is missed, work done for earlier changes in that frame is repeated once.
+        template<typename ComponentType, typename Fn>
+        void eachChanged(uint64_t since, Fn&& fn){
+            auto storage = static_cast<SparseComponentStorage<ComponentType>*>(findStorage(type_index<ComponentType>()));
+            if(!storage)
+                return;
+            storage->forEachChanged(since, [&](size_t entity_id){
+                fn(entity_id, *storage->get(entity_id));
+            });
+        }
+        
+        inline ComponentStorageMode getStorageMode() const { return mArchetypes ? ComponentStorageMode::ARCHETYPE : ComponentStorageMode::PER_TYPE; }
+        //nullptr unless the scene uses archetype storage
+        inline const ArchetypeStorage* getArchetypeStorage() const { return mArchetypes.get(); }
+        
+        //Per type component counts and memory, allocation counts from the scene's AllocationManager and
+        //getComponent lookups. Walks every storage and policy, meant for reports rather than every frame.
+        SceneStats getStats() const;
+        //getStats() as JSON, written to path when one is given
+        std::string dumpStats(const std::string& path = "") const;
+        
         inline bool hasStarted() const { return mHasStarted; }
         
         inline bool isTransitioning() const { return mIsTransitioning; }
@@ -249,10 +413,46 @@ namespace mediasystem {
             return Allocator<T>(&mAllocationManager, fmt);
         }
         
+        //Cues run from notifyUpdate against the elapsed time it is given. Ids are unique within the scene,
+        //INVALID_CUE_ID if the cue couldn't be created.
         CueId cueAtTime(float seconds, std::function<void()> handler);
         CueId cueFromNow(float seconds, std::function<void()> handler);
         CueId cueInterval(float seconds, std::function<void()> handler);
         void cancelCue(CueId id);
+        inline bool hasCue(CueId id) const { return mCues.has(id); }
+        inline size_t getNumCues() const { return mCues.size(); }
+        
+        //Incremental loading. A scene queues its construction work as steps, ie. from init(), and they run
+        //in order from notifyUpdate until the load budget for that frame is used up, at least one per update
+        //so loading always moves on. A resumable step returns true once it's finished and is called again
+        //next time otherwise. addLoadSteps splits count items into count steps. Steps may queue more steps.
+        //LoadComplete is triggered once the queue runs dry. SceneManager also advances scenes that aren't
+        //being updated yet, so the next scene can fill in while the current one keeps animating.
+        using LoadStep = std::function<bool()>;
+        void addLoadStep(LoadStep step);
+        void addLoadSteps(size_t count, std::function<void(size_t)> step);
+        //runs steps for up to the load budget, returns true once nothing is left to load
+        bool updateLoading();
+        inline void setLoadBudget(float milliseconds){ mLoadBudget = milliseconds; }
+        inline float getLoadBudget() const { return mLoadBudget; }
+        inline bool isLoading() const { return !mLoadSteps.empty(); }
+        //finished steps out of every step queued since loading last completed, 1 when there is nothing to load
+        inline float getLoadProgress() const { return mNumLoadSteps ? float(mNumLoadedSteps) / float(mNumLoadSteps) : 1.f; }
+        
+        //Update delegates that don't need to run every frame, ie. bounds refreshes or background bookkeeping.
+        //They run after the regular Update delegates and systems on the frames their rate picks, in the order
+        //they were added, and the last frame time of their Update is the time since they last ran. They are
+        //profiled and budgeted along with the other Update delegates. An every frame rate is a plain Update
+        //delegate.
+        void addUpdateDelegate(EventDelegate delegate, const UpdateRate& rate, const std::string& name = "");
+        void removeUpdateDelegate(const EventDelegate& delegate);
+        inline size_t getNumRatedUpdates() const { return mRatedUpdates.size(); }
+        
+        //The one call here that is safe from any thread. Buffers are applied on the main thread in the
+        //order they were submitted, at the start of the next notifyUpdate before cues and systems run.
+        void submit(CommandBuffer&& commands);
+        //buffers waiting for the next update
+        size_t getNumPendingCommands();
         
 	protected:
         
@@ -281,13 +481,63 @@ namespace mediasystem {
         
 		std::string	mName;
         AllocationManager mAllocationManager;
-        std::map<size_t, EntityStrongHandle, std::less<size_t>, Allocator<std::pair<const size_t, EntityStrongHandle>>> mEntities{ Allocator<std::pair<const size_t, EntityStrongHandle>>(&mAllocationManager) };
+        //entity index -> entity, empty slots are on the free list
+        std::vector<EntityStrongHandle, Allocator<EntityStrongHandle>> mEntities{ Allocator<EntityStrongHandle>(&mAllocationManager) };
+        //entity index -> id last handed out for that slot, carries the generation
+        std::vector<size_t, Allocator<size_t>> mEntityIds{ Allocator<size_t>(&mAllocationManager) };
+        //reused first in first out so generations of a single slot don't churn
+        std::deque<size_t, Allocator<size_t>> mFreeEntities{ Allocator<size_t>(&mAllocationManager) };
 
 	private:
         
         void clearComponents();
+        //the scheduler times its systems into the Update profiler once Update is profiled
+        void onProfilerCreated(type_id_t type, DelegateProfiler& profiler) override;
+        
+        //creates the entity and its default components without queueing any events
+        size_t spawnEntity();
+        //spawns count entities and queues the batched events for them
+        std::shared_ptr<const std::vector<size_t>> spawnEntities(size_t count);
+        void markComponent(size_t entity_id, type_index_t type);
+        void unmarkComponent(size_t entity_id, type_index_t type);
+        //forwards to the TransformSystem, which is only complete in Scene.cpp
+        void markTransformDirty(size_t entity_id);
+        Entity& getEntityRef(size_t entity_id){ return *mEntities[getEntityIndex(entity_id)]; }
+        
+        template<typename ComponentType>
+        void copyComponents(const std::shared_ptr<const std::vector<size_t>>& ids, const ComponentType& prototype){
+            auto& storage = getStorage<ComponentType>();
+            storage.reserve(ids->size());
+            std::vector<ComponentHandle<ComponentType>> handles;
+            handles.reserve(ids->size());
+            for(auto id : *ids){
+                if(copyComponent(storage, id, prototype, std::is_constructible<ComponentType, Entity&, const ComponentType&>())){
+                    markComponent(id, type_index<ComponentType>());
+                    handles.push_back(storage.getComponentHandle(id));
+                }else{
+                    //keep the handles parallel to the ids
+                    handles.emplace_back();
+                }
+            }
+            queueEvent<NewComponents<ComponentType>>(ids, std::move(handles));
+        }
+        
+        template<typename ComponentType>
+        bool copyComponent(SparseComponentStorage<ComponentType>& storage, size_t entity_id, const ComponentType& prototype, std::true_type){
+            return emplaceComponent(storage, entity_id, is_relocatable_component<ComponentType>(), getEntityRef(entity_id), prototype);
+        }
+        
+        template<typename ComponentType>
+        bool copyComponent(SparseComponentStorage<ComponentType>& storage, size_t entity_id, const ComponentType& prototype, std::false_type){
+            return emplaceComponent(storage, entity_id, is_relocatable_component<ComponentType>(), prototype);
+        }
         
+        //destroys the components of a batch of live entities one storage at a time and frees their slots
         void collectEntities();
+        void releaseEntities(const std::vector<size_t>& ids);
+        //hands the per update construct and destroy batches to their observers
+        void flushLifecycleBatches();
+        void applyCommands();
         
         void notifyStart();
         void notifyStop();
@@ -302,24 +552,109 @@ namespace mediasystem {
         float mTransitionStart{0.f};
         
         bool mHasStarted{false};
-        std::map<type_id_t, GenericComponentMap> mComponents;
+        uint64_t mFrame{0};
+        
+        //systems may look components up from worker threads
+        inline void countLookup(){ mLookups.fetch_add(1, std::memory_order_relaxed); }
+        void countMiss(size_t entity_id){
+            mMisses.fetch_add(1, std::memory_order_relaxed);
+            ofLogVerbose("Scene") << "Entity id: " << entity_id << " does not have component";
+        }
+        std::atomic<size_t> mLookups{0};
+        std::atomic<size_t> mMisses{0};
+        ComponentLookupStats mLastFrameLookups;
+        ComponentLookupStats mTotalLookups; //up to the last complete update
+        inline IComponentStorage* findStorage(type_index_t type){
+            return type < mComponents.size() ? mComponents[type].get() : nullptr;
+        }
+        
+        template<typename ComponentType>
+        SparseComponentStorage<ComponentType>& getStorage(){
+            auto type = type_index<ComponentType>();
+            if(auto storage = findStorage(type)){
+                return *static_cast<SparseComponentStorage<ComponentType>*>(storage);
+            }
+            if(type >= mComponents.size()){
+                mComponents.resize(type + 1);
+            }
+            auto storage = new SparseComponentStorage<ComponentType>(&mAllocationManager, &mFrame);
+            mComponents[type].reset(storage);
+            if(mArchetypes){
+                registerArchetypeType<ComponentType>(storage, is_relocatable_component<ComponentType>());
+            }
+            return *storage;
+        }
+        
+        template<typename ComponentType>
+        void registerArchetypeType(SparseComponentStorage<ComponentType>* storage, std::true_type){
+            mArchetypes->registerType<ComponentType>(storage);
+        }
+        
+        template<typename ComponentType>
+        void registerArchetypeType(SparseComponentStorage<ComponentType>* storage, std::false_type){}
+        
+        template<typename ComponentType, typename...Args>
+        bool emplaceComponent(SparseComponentStorage<ComponentType>& storage, size_t entity_id, std::true_type, Args&&...args){
+            if(!storage.isExternal())
+                return storage.emplace(entity_id, std::forward<Args>(args)...) != nullptr;
+            if(storage.has(entity_id))
+                return false;
+            return mArchetypes->emplace<ComponentType>(entity_id, std::forward<Args>(args)...) != nullptr;
+        }
+        
+        template<typename ComponentType, typename...Args>
+        bool emplaceComponent(SparseComponentStorage<ComponentType>& storage, size_t entity_id, std::false_type, Args&&...args){
+            return storage.emplace(entity_id, std::forward<Args>(args)...) != nullptr;
+        }
+        
+        //indexed by type_index, null for types this scene never stored
+        std::vector<std::unique_ptr<IComponentStorage>> mComponents;
+        //observe the storages, released first in ~Scene
+        std::vector<std::unique_ptr<ComponentQueryBase>> mQueries;
+        //declared after the storages so it is torn down first, it unlinks its objects from them
+        std::unique_ptr<ArchetypeStorage> mArchetypes;
+        TransformSystem* mTransforms{nullptr};
+        //declared before the systems so they can unregister while being destroyed
+        SystemScheduler mScheduler;
+        struct RatedUpdate {
+            EventDelegate delegate; //null once removed while rated updates are running
+            UpdateRate rate;
+            double nextTime{0.}; //FIXED_HZ
+            float lastTime{0.f};
+            bool hasRun{false};
+        };
+        void updateRated(size_t elapsedFrames, float elapsedTime, float prevFrameTime);
+        bool isDue(RatedUpdate& rated, float elapsedTime);
+        std::vector<RatedUpdate> mRatedUpdates;
+        bool mUpdatingRated{false};
         std::map<type_id_t, StrongHandle<void>> mSystems;
         std::deque<size_t> mDestroyedEntities;
+        std::vector<std::vector<size_t>> mReleasedByType; //indexed by type_index, kept to reuse the buckets
         std::string mPreviousScene;
         StateMachine mSequence;
         
-        struct Cue {
-            std::function<void()> handler;
-            float executionTime{0.f};
-            float interval{0.f};
-            bool repeats{false};
-            size_t id;
-        };
-        
         float mCurrentTime{0};
-        std::list<Cue> mStagedCues;
-        std::list<Cue> mCues;
+        CueScheduler mCues;
+        struct PendingLoad {
+            LoadStep resumable;
+            std::function<void(size_t)> each;
+            size_t count{1};
+            size_t next{0};
+        };
+        std::deque<PendingLoad> mLoadSteps;
+        size_t mNumLoadSteps{0};
+        size_t mNumLoadedSteps{0};
+        float mLoadBudget{2.f}; //milliseconds per update
+        std::chrono::steady_clock::time_point mLoadStart;
+        std::mutex mCommandsMutex;
+        std::vector<CommandBuffer> mPendingCommands;
+        std::vector<CommandBuffer> mApplyingCommands; //swapped with mPendingCommands to keep both allocations
         friend class SceneManager;
+        friend class TransformSystem;
+        friend class SceneSnapshot;
+        friend class Prefab;
+        friend class CommandBuffer;
+        friend struct EntityGraph;
 	};
     
 }//end namespace mediasystem
@@ -192,6 +192,12 @@ namespace mediasystem {
         if(mNextScene)
             mNextScene->notifyUpdate(framenum, time, dt);
         
+        //scenes waiting in the wings keep loading within their budget
+        for(auto & scene : mScenes){
+            if(scene->isLoading() && scene != mCurrentScene && scene != mNextScene)
+                scene->updateLoading();
+        }
+        
         mPrevTime = time;
     }
     
@@ -0,0 +1,368 @@
+//
+//  SceneSnapshot.cpp
+//  ofxMediaSystem
+//
+
+#include "SceneSnapshot.h"
+#include <cstdio>
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace mediasystem {
+
+    namespace {
+
+        //File layout, all values little endian as written by the saving machine, the endian tag rejects
+        //files from the other kind:
+        //  header    magic, version, endian tag, entity count, section count
+        //  entities  parent snapshot index (-1 for roots), position xyz, orientation xyzw, scale xyz
+        //            parents always precede their children
+        //  sections  name length, name, hooked flag, element size, record count, payload byte length, payload
+        //            raw payloads are every record's entity index followed by every record's bytes,
+        //            hooked payloads are an entity index, a byte length and the bytes per record
+        const char MAGIC[4] = {'M','S','S','N'};
+        const uint32_t ENDIAN_TAG = 0x01020304;
+        const size_t ENTITY_RECORD_SIZE = sizeof(int32_t) + sizeof(float) * 10;
+
+        struct Writer {
+            std::vector<unsigned char> buffer;
+
+            template<typename T>
+            void put(const T& value){
+                append(&value, sizeof(T));
+            }
+            void append(const void* data, size_t size){
+                auto bytes = static_cast<const unsigned char*>(data);
+                buffer.insert(buffer.end(), bytes, bytes + size);
+            }
+        };
+
+        //bounds checked, every read fails once one has run past the end
+        struct Reader {
+            const unsigned char* pos;
+            const unsigned char* end;
+
+            template<typename T>
+            bool get(T& value){
+                auto data = take(sizeof(T));
+                if(!data)
+                    return false;
+                std::memcpy(&value, data, sizeof(T));
+                return true;
+            }
+            const unsigned char* take(size_t size){
+                if(!pos || size_t(end - pos) < size){
+                    pos = nullptr;
+                    return nullptr;
+                }
+                auto data = pos;
+                pos += size;
+                return data;
+            }
+        };
+
+        //read only view of a whole file, mapped where the platform allows it and read in one go elsewhere
+        class MappedFile {
+        public:
+            explicit MappedFile(const std::string& path){
+#if !defined(_WIN32)
+                int fd = ::open(path.c_str(), O_RDONLY);
+                if(fd < 0)
+                    return;
+                struct stat info;
+                if(::fstat(fd, &info) == 0 && info.st_size > 0){
+                    auto mapped = ::mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                    if(mapped != MAP_FAILED){
+                        mData = static_cast<const unsigned char*>(mapped);
+                        mSize = size_t(info.st_size);
+                        mMapped = true;
+                    }
+                }
+                ::close(fd);
+                if(mMapped)
+                    return;
+#endif
+                if(auto file = std::fopen(path.c_str(), "rb")){
+                    std::fseek(file, 0, SEEK_END);
+                    auto size = std::ftell(file);
+                    std::fseek(file, 0, SEEK_SET);
+                    if(size > 0){
+                        mBuffer.resize(size_t(size));
+                        if(std::fread(mBuffer.data(), 1, mBuffer.size(), file) == mBuffer.size()){
+                            mData = mBuffer.data();
+                            mSize = mBuffer.size();
+                        }
+                    }
+                    std::fclose(file);
+                }
+            }
+
+            ~MappedFile(){
+#if !defined(_WIN32)
+                if(mMapped)
+                    ::munmap(const_cast<unsigned char*>(mData), mSize);
+#endif
+            }
+
+            MappedFile(const MappedFile&) = delete;
+            MappedFile& operator=(const MappedFile&) = delete;
+
+            inline const unsigned char* data() const { return mData; }
+            inline size_t size() const { return mSize; }
+
+        private:
+            const unsigned char* mData{nullptr};
+            size_t mSize{0};
+            bool mMapped{false};
+            std::vector<unsigned char> mBuffer;
+        };
+
+    }
+
+    bool SceneSnapshot::save(const std::string& path)
+    {
+        //preorder over the hierarchy so parents are always loaded before their children
+        auto graphs = mScene.view<EntityGraph>();
+        std::vector<size_t> order;
+        std::vector<int32_t> indices(mScene.mEntityIds.size(), -1);
+        order.reserve(mScene.getNumEntities());
+        graphs.each([&](size_t entity_id, EntityGraph& root){
+            if(root.hasParent())
+                return;
+            for(auto & graph : root.getSubtree()){
+                auto id = graph.self.getId();
+                indices[getEntityIndex(id)] = int32_t(order.size());
+                order.push_back(id);
+            }
+        });
+
+        Writer out;
+        out.append(MAGIC, sizeof(MAGIC));
+        out.put(FORMAT_VERSION);
+        out.put(ENDIAN_TAG);
+        out.put(uint32_t(order.size()));
+        out.put(uint32_t(mComponents.size()));
+
+        auto& nodes = mScene.getStorage<ofNode>();
+        out.buffer.reserve(out.buffer.size() + order.size() * ENTITY_RECORD_SIZE);
+        for(auto id : order){
+            auto& graph = graphs.get<EntityGraph>(id);
+            int32_t parent = graph.hasParent() ? indices[getEntityIndex(graph.parent)] : -1;
+            auto node = nodes.get(id);
+            auto position = node->getPosition();
+            auto orientation = node->getOrientationQuat();
+            auto scale = node->getScale();
+            float transform[10] = {
+                position.x, position.y, position.z,
+                orientation.x, orientation.y, orientation.z, orientation.w,
+                scale.x, scale.y, scale.z
+            };
+            out.put(parent);
+            out.append(transform, sizeof(transform));
+        }
+
+        std::vector<unsigned char> bytes;
+        for(auto & entry : mComponents){
+            out.put(uint32_t(entry.name.size()));
+            out.append(entry.name.data(), entry.name.size());
+            out.put(uint32_t(entry.size == 0 ? 1 : 0));
+            out.put(uint32_t(entry.size));
+
+            auto storage = mScene.findStorage(entry.type);
+            std::vector<size_t> owners;
+            if(storage){
+                for(auto id : order){
+                    if(storage->has(id))
+                        owners.push_back(id);
+                }
+            }
+            out.put(uint32_t(owners.size()));
+            auto lengthAt = out.buffer.size();
+            out.put(uint64_t(0));
+            auto payloadAt = out.buffer.size();
+
+            if(entry.size){
+                for(auto id : owners){
+                    out.put(uint32_t(indices[getEntityIndex(id)]));
+                }
+                for(auto id : owners){
+                    out.append(storage->getComponentPtr(id), entry.size);
+                }
+            }else{
+                for(auto id : owners){
+                    bytes.clear();
+                    entry.save(storage->getComponentPtr(id), bytes);
+                    out.put(uint32_t(indices[getEntityIndex(id)]));
+                    out.put(uint32_t(bytes.size()));
+                    out.append(bytes.data(), bytes.size());
+                }
+            }
+            uint64_t length = out.buffer.size() - payloadAt;
+            std::memcpy(out.buffer.data() + lengthAt, &length, sizeof(length));
+        }
+
+        auto file = std::fopen(path.c_str(), "wb");
+        if(!file){
+            ofLogError("SceneSnapshot") << "Can't open " << path << " for writing.";
+            return false;
+        }
+        bool written = std::fwrite(out.buffer.data(), 1, out.buffer.size(), file) == out.buffer.size();
+        written = std::fclose(file) == 0 && written;
+        if(!written)
+            ofLogError("SceneSnapshot") << "Failed writing " << path;
+        return written;
+    }
+
+    bool SceneSnapshot::load(const std::string& path)
+    {
+        mLoaded.clear();
+        MappedFile file(path);
+        if(!file.data()){
+            ofLogError("SceneSnapshot") << "Can't read " << path;
+            return false;
+        }
+
+        Reader in{file.data(), file.data() + file.size()};
+        auto magic = in.take(sizeof(MAGIC));
+        uint32_t version = 0, endian = 0, entityCount = 0, sectionCount = 0;
+        in.get(version);
+        in.get(endian);
+        in.get(entityCount);
+        in.get(sectionCount);
+        if(!magic || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 || endian != ENDIAN_TAG){
+            ofLogError("SceneSnapshot") << path << " is not a snapshot or was saved on a machine of different endianness.";
+            return false;
+        }
+        if(version != FORMAT_VERSION){
+            ofLogError("SceneSnapshot") << path << " has format version " << version << ", expected " << FORMAT_VERSION;
+            return false;
+        }
+        auto entities = in.take(size_t(entityCount) * ENTITY_RECORD_SIZE);
+
+        //everything is validated before the first entity is created
+        struct Section {
+            const ComponentEntry* entry;
+            uint32_t count;
+            const unsigned char* payload;
+            uint64_t length;
+        };
+        std::vector<Section> sections;
+        bool corrupt = false;
+        for(uint32_t i = 0; !corrupt && i < sectionCount; ++i){
+            uint32_t nameLength = 0, hooked = 0, elementSize = 0, count = 0;
+            uint64_t length = 0;
+            in.get(nameLength);
+            auto name = in.take(nameLength);
+            in.get(hooked);
+            in.get(elementSize);
+            in.get(count);
+            in.get(length);
+            auto payload = in.take(length);
+            if(!payload){
+                corrupt = true;
+                break;
+            }
+
+            const ComponentEntry* entry = nullptr;
+            for(auto & candidate : mComponents){
+                if(candidate.name.size() == nameLength && std::memcmp(candidate.name.data(), name, nameLength) == 0){
+                    entry = &candidate;
+                    break;
+                }
+            }
+            std::string sectionName(reinterpret_cast<const char*>(name), nameLength);
+            if(!entry){
+                ofLogWarning("SceneSnapshot") << "Skipping unregistered component " << sectionName << " in " << path;
+                continue;
+            }
+            if(hooked != (entry->size == 0 ? 1u : 0u) || elementSize != entry->size){
+                ofLogWarning("SceneSnapshot") << "Skipping component " << sectionName << " in " << path << ", it was registered differently when saved.";
+                continue;
+            }
+
+            bool valid = true;
+            Reader records{payload, payload + length};
+            if(entry->size){
+                valid = length == uint64_t(count) * (sizeof(uint32_t) + entry->size);
+                for(uint32_t r = 0; valid && r < count; ++r){
+                    uint32_t index = 0;
+                    valid = records.get(index) && index < entityCount;
+                }
+            }else{
+                for(uint32_t r = 0; valid && r < count; ++r){
+                    uint32_t index = 0, size = 0;
+                    valid = records.get(index) && index < entityCount && records.get(size) && records.take(size);
+                }
+            }
+            if(!valid){
+                corrupt = true;
+                break;
+            }
+            sections.push_back({entry, count, payload, length});
+        }
+
+        std::vector<int32_t> parents(entityCount);
+        Reader table{entities, entities ? entities + size_t(entityCount) * ENTITY_RECORD_SIZE : nullptr};
+        for(uint32_t i = 0; entities && i < entityCount; ++i){
+            table.get(parents[i]);
+            table.take(sizeof(float) * 10);
+            if(parents[i] >= int32_t(i) || parents[i] < -1)
+                corrupt = true;
+        }
+        if(corrupt || !entities){
+            ofLogError("SceneSnapshot") << path << " is truncated or corrupt.";
+            return false;
+        }
+
+        auto ids = mScene.spawnEntities(entityCount);
+        if(ids->size() != entityCount){
+            for(auto id : *ids){
+                mScene.destroyEntity(id);
+            }
+            return false;
+        }
+
+        auto& nodes = mScene.getStorage<ofNode>();
+        table = Reader{entities, entities + size_t(entityCount) * ENTITY_RECORD_SIZE};
+        for(uint32_t i = 0; i < entityCount; ++i){
+            int32_t parent;
+            float transform[10];
+            table.get(parent);
+            table.get(transform);
+            auto node = nodes.get((*ids)[i]);
+            node->setPosition(glm::vec3(transform[0], transform[1], transform[2]));
+            node->setOrientation(glm::quat(transform[6], transform[3], transform[4], transform[5]));
+            node->setScale(glm::vec3(transform[7], transform[8], transform[9]));
+        }
+
+        for(auto & section : sections){
+            auto entry = section.entry;
+            if(entry->size){
+                entry->loadRaw(mScene, *ids, section.payload, section.payload + size_t(section.count) * sizeof(uint32_t), section.count);
+            }else{
+                Reader records{section.payload, section.payload + section.length};
+                for(uint32_t r = 0; r < section.count; ++r){
+                    uint32_t index = 0, size = 0;
+                    records.get(index);
+                    records.get(size);
+                    auto data = records.take(size);
+                    entry->load(mScene.getEntityRef((*ids)[index]), data, size);
+                }
+            }
+        }
+
+        //parented last, nodes that move between archetype chunks while linked have to patch their relatives
+        for(uint32_t i = 0; i < entityCount; ++i){
+            if(parents[i] >= 0)
+                mScene.getEntityRef((*ids)[i]).setParent(mScene.getEntity((*ids)[parents[i]]), false);
+        }
+
+        mLoaded = *ids;
+        return true;
+    }
+
+}//end namespace mediasystem
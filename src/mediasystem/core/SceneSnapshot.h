@@ -0,0 +1,110 @@
+//
+//  SceneSnapshot.h
+//  ofxMediaSystem
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <type_traits>
+#include "mediasystem/core/Scene.h"
+#include "mediasystem/core/Entity.h"
+
+namespace mediasystem {
+
+    //Saves a scene's entities, their hierarchy and local transforms, and the registered component
+    //types to a versioned binary file, and loads them back into a scene. Loading maps the file and
+    //copies trivially copyable components straight into their storages, it queues the batched
+    //NewEntities and NewComponents events instead of one event per entity and component.
+    //
+    //Components are matched by the name they are registered with, so names must stay the same
+    //between the run that saves and the one that loads. Sections of unregistered names are skipped.
+    class SceneSnapshot {
+    public:
+
+        static constexpr uint32_t FORMAT_VERSION = 1;
+
+        using SaveHook = std::function<void(const void* component, std::vector<unsigned char>& out)>;
+        using LoadHook = std::function<void(Entity& entity, const unsigned char* data, size_t size)>;
+
+        explicit SceneSnapshot(Scene& scene):mScene(scene){}
+
+        //Stored as raw bytes, so the type must not hold pointers, references or handles.
+        template<typename ComponentType>
+        void registerComponent(std::string name){
+            static_assert(std::is_trivially_copyable<ComponentType>::value, "Components without serialize hooks must be trivially copyable.");
+            ComponentEntry entry;
+            entry.name = std::move(name);
+            entry.type = type_index<ComponentType>();
+            entry.size = sizeof(ComponentType);
+            entry.loadRaw = &SceneSnapshot::loadRaw<ComponentType>;
+            mComponents.push_back(std::move(entry));
+        }
+
+        //save appends the component's bytes to out, load recreates the component on the entity,
+        //ie. through Entity::createComponent.
+        template<typename ComponentType>
+        void registerComponent(std::string name, std::function<void(const ComponentType&, std::vector<unsigned char>&)> save, LoadHook load){
+            ComponentEntry entry;
+            entry.name = std::move(name);
+            entry.type = type_index<ComponentType>();
+            entry.save = [save](const void* component, std::vector<unsigned char>& out){
+                save(*static_cast<const ComponentType*>(component), out);
+            };
+            entry.load = std::move(load);
+            mComponents.push_back(std::move(entry));
+        }
+
+        //overwrites path, false if it can't be written
+        bool save(const std::string& path);
+        //adds the snapshot's entities to the scene, false if the file is missing, corrupt or of another version
+        bool load(const std::string& path);
+
+        //ids of the entities created by the last load, in the order they were saved
+        inline const std::vector<size_t>& getLoadedEntities() const { return mLoaded; }
+
+    private:
+
+        struct ComponentEntry {
+            std::string name;
+            type_index_t type{INVALID_TYPE_INDEX};
+            size_t size{0}; //0 when stored through hooks
+            void(*loadRaw)(Scene& scene, const std::vector<size_t>& ids, const unsigned char* entities, const unsigned char* data, size_t count){nullptr};
+            SaveHook save;
+            LoadHook load;
+        };
+
+        template<typename ComponentType>
+        static void loadRaw(Scene& scene, const std::vector<size_t>& ids, const unsigned char* entities, const unsigned char* data, size_t count){
+            auto& storage = scene.getStorage<ComponentType>();
+            storage.reserve(count);
+            auto loaded = std::make_shared<std::vector<size_t>>();
+            loaded->reserve(count);
+            std::vector<ComponentHandle<ComponentType>> handles;
+            handles.reserve(count);
+            for(size_t i = 0; i < count; ++i){
+                uint32_t entity;
+                std::memcpy(&entity, entities + i * sizeof(entity), sizeof(entity));
+                auto id = ids[entity];
+                //the mapped bytes carry no alignment guarantee
+                typename std::aligned_storage<sizeof(ComponentType), alignof(ComponentType)>::type raw;
+                std::memcpy(&raw, data + i * sizeof(ComponentType), sizeof(ComponentType));
+                if(scene.emplaceComponent(storage, id, is_relocatable_component<ComponentType>(), *reinterpret_cast<const ComponentType*>(&raw))){
+                    scene.markComponent(id, type_index<ComponentType>());
+                    loaded->push_back(id);
+                    handles.push_back(storage.getComponentHandle(id));
+                }
+            }
+            scene.queueEvent<NewComponents<ComponentType>>(std::move(loaded), std::move(handles));
+        }
+
+        Scene& mScene;
+        std::vector<ComponentEntry> mComponents;
+        std::vector<size_t> mLoaded;
+    };
+
+}//end namespace mediasystem
@@ -0,0 +1,147 @@
+//
+//  SceneStats.cpp
+//  ofxMediaSystem
+//
+
+#include "SceneStats.h"
+#include <sstream>
+
+namespace mediasystem {
+
+    namespace {
+
+        //type names are the only free form strings
+        std::string quote(const std::string& str){
+            std::string ret;
+            ret.reserve(str.size() + 2);
+            ret += '"';
+            for(auto c : str){
+                if(c == '"' || c == '\\'){
+                    ret += '\\';
+                    ret += c;
+                }else if(static_cast<unsigned char>(c) < 0x20){
+                    ret += ' ';
+                }else{
+                    ret += c;
+                }
+            }
+            ret += '"';
+            return ret;
+        }
+
+        void writeMemory(std::ostream& out, const ComponentStorageMemory& memory){
+            out << "{\"objectSize\":" << memory.objectSize
+                << ",\"capacity\":" << memory.capacity
+                << ",\"bytesReserved\":" << memory.bytesReserved
+                << ",\"bytesUsed\":" << memory.bytesUsed << "}";
+        }
+
+        void writeLookups(std::ostream& out, const ComponentLookupStats& lookups){
+            out << "{\"lookups\":" << lookups.lookups << ",\"misses\":" << lookups.misses << "}";
+        }
+
+        void writeTiming(std::ostream& out, const DelegateTiming& timing){
+            out << "{\"name\":" << quote(timing.name)
+                << ",\"calls\":" << timing.calls
+                << ",\"last\":" << timing.last
+                << ",\"average\":" << timing.average
+                << ",\"p99\":" << timing.p99
+                << ",\"max\":" << timing.max
+                << ",\"budget\":" << timing.budget
+                << ",\"overBudget\":" << timing.overBudget << "}";
+        }
+
+        void writeDispatch(std::ostream& out, const DispatchStats& dispatch){
+            out << "{\"dispatch\":";
+            writeTiming(out, dispatch.dispatch);
+            out << ",\"delegates\":[";
+            for(size_t i = 0; i < dispatch.delegates.size(); ++i){
+                if(i > 0)
+                    out << ",";
+                writeTiming(out, dispatch.delegates[i]);
+            }
+            out << "]}";
+        }
+
+    }
+
+    size_t SceneStats::getBytesReserved() const
+    {
+        auto ret = archetypes.bytesReserved;
+        for(auto & component : components){
+            ret += component.memory.bytesReserved;
+        }
+        return ret;
+    }
+
+    size_t SceneStats::getBytesUsed() const
+    {
+        auto ret = archetypes.bytesUsed;
+        for(auto & component : components){
+            ret += component.memory.bytesUsed;
+        }
+        return ret;
+    }
+
+    std::string SceneStats::toJson() const
+    {
+        std::ostringstream out;
+        out << "{\"scene\":" << quote(scene)
+            << ",\"frame\":" << frame
+            << ",\"entities\":{\"count\":" << numEntities << ",\"capacity\":" << entityCapacity << "}"
+            << ",\"bytesReserved\":" << getBytesReserved()
+            << ",\"bytesUsed\":" << getBytesUsed();
+
+        out << ",\"components\":[";
+        for(size_t i = 0; i < components.size(); ++i){
+            auto& component = components[i];
+            if(i > 0)
+                out << ",";
+            out << "{\"type\":" << component.type
+                << ",\"name\":" << quote(component.name)
+                << ",\"count\":" << component.count
+                << ",\"external\":" << (component.external ? "true" : "false")
+                << ",\"memory\":";
+            writeMemory(out, component.memory);
+            out << "}";
+        }
+        out << "]";
+
+        out << ",\"archetypes\":{\"count\":" << numArchetypes << ",\"chunks\":" << numChunks << ",\"memory\":";
+        writeMemory(out, archetypes);
+        out << "}";
+
+        out << ",\"allocations\":[";
+        for(size_t i = 0; i < allocations.size(); ++i){
+            auto& allocation = allocations[i];
+            if(i > 0)
+                out << ",";
+            out << "{\"name\":" << quote(allocation.name)
+                << ",\"allocations\":" << allocation.stats.allocations
+                << ",\"deallocations\":" << allocation.stats.deallocations
+                << ",\"liveObjects\":" << allocation.stats.liveObjects
+                << ",\"peakObjects\":" << allocation.stats.peakObjects
+                << ",\"objectSize\":" << allocation.stats.objectSize
+                << ",\"liveBytes\":" << allocation.stats.getLiveBytes()
+                << ",\"bytesReserved\":" << allocation.stats.bytesReserved << "}";
+        }
+        out << "]";
+
+        out << ",\"lookups\":{\"lastFrame\":";
+        writeLookups(out, lastFrameLookups);
+        out << ",\"frame\":";
+        writeLookups(out, frameLookups);
+        out << ",\"total\":";
+        writeLookups(out, totalLookups);
+        out << "}";
+
+        //milliseconds
+        out << ",\"update\":";
+        writeDispatch(out, update);
+        out << ",\"draw\":";
+        writeDispatch(out, draw);
+        out << "}";
+        return out.str();
+    }
+
+}//end namespace mediasystem
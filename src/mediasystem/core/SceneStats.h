@@ -0,0 +1,68 @@
+//
+//  SceneStats.h
+//  ofxMediaSystem
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "mediasystem/core/ComponentStorage.h"
+#include "mediasystem/memory/Memory.h"
+#include "mediasystem/events/DelegateProfiler.h"
+
+namespace mediasystem {
+
+    //Scene::getComponent calls, misses are lookups for an entity without the component
+    struct ComponentLookupStats {
+        size_t lookups{0};
+        size_t misses{0};
+    };
+
+    struct ComponentTypeStats {
+        type_index_t type{0};
+        std::string name; //compiler specific
+        size_t count{0};
+        bool external{false}; //objects live in the archetype chunks, memory only covers the index
+        ComponentStorageMemory memory;
+    };
+
+    struct AllocationTypeStats {
+        std::string name; //compiler specific
+        AllocationStats stats;
+    };
+
+    //Update or Draw timings, empty unless the scene profiles that event, see EventManager::profileDelegates
+    struct DispatchStats {
+        DelegateTiming dispatch; //every delegate together
+        std::vector<DelegateTiming> delegates;
+    };
+
+    //Snapshot of what a scene holds, see Scene::getStats. Byte figures come from the storages and are
+    //separate from the allocation figures, which count what went through the scene's AllocationManager.
+    //Both overlap since the storages allocate through it.
+    struct SceneStats {
+        std::string scene;
+        uint64_t frame{0};
+        size_t numEntities{0};
+        size_t entityCapacity{0}; //entity slots, live and free
+        std::vector<ComponentTypeStats> components; //every type the scene has a storage for
+        size_t numArchetypes{0};
+        size_t numChunks{0};
+        ComponentStorageMemory archetypes; //chunk memory, empty unless the scene uses archetype storage
+        std::vector<AllocationTypeStats> allocations;
+        ComponentLookupStats lastFrameLookups; //the last complete update
+        ComponentLookupStats frameLookups; //so far in the current one
+        ComponentLookupStats totalLookups;
+        DispatchStats update;
+        DispatchStats draw;
+
+        //component storages plus archetype chunks
+        size_t getBytesReserved() const;
+        size_t getBytesUsed() const;
+
+        std::string toJson() const;
+    };
+
+}//end namespace mediasystem
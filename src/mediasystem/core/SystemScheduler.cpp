@@ -0,0 +1,223 @@
+//
+//  SystemScheduler.cpp
+//  ofxMediaSystem
+//
+
+#include "SystemScheduler.h"
+#include "mediasystem/util/BasicTimer.hpp"
+#include <sstream>
+#include <algorithm>
+#include <initializer_list>
+#include <condition_variable>
+
+namespace mediasystem {
+
+    SystemAccess& SystemAccess::merge(const SystemAccess& other)
+    {
+        other.mReads.forEach([this](type_index_t type){ mReads.set(type); });
+        other.mWrites.forEach([this](type_index_t type){ mWrites.set(type); });
+        mMainThread = mMainThread || other.mMainThread;
+        mExclusive = mExclusive || other.mExclusive;
+        return *this;
+    }
+
+    bool SystemAccess::conflicts(const SystemAccess& other) const
+    {
+        return mExclusive || other.mExclusive ||
+            mWrites.intersects(other.mWrites) ||
+            mWrites.intersects(other.mReads) ||
+            other.mWrites.intersects(mReads);
+    }
+
+    void SystemScheduler::add(std::string name, SystemAccess access, EventDelegate delegate)
+    {
+        System system;
+        system.name = std::move(name);
+        system.access = std::move(access);
+        system.delegate = std::move(delegate);
+        //running systems hold references into mSystems
+        (mRunning ? mAdded : mSystems).push_back(std::move(system));
+        mDirty = true;
+    }
+
+    void SystemScheduler::remove(EventDelegate delegate)
+    {
+        for(auto list : {&mSystems, &mAdded}){
+            for(auto & system : *list){
+                if(!system.removed && system.delegate == delegate){
+                    system.removed = true;
+                    mDirty = true;
+                    if(mProfiler){
+                        std::lock_guard<std::mutex> lock(mProfilerMutex);
+                        mProfiler->remove(delegate);
+                    }
+                    return;
+                }
+            }
+        }
+        MS_LOG_WARNING("Attemping to remove an unknown scheduled system");
+    }
+
+    void SystemScheduler::setProfiler(DelegateProfiler* profiler, EventManager* events)
+    {
+        mProfiler = profiler;
+        mEvents = events;
+    }
+
+    void SystemScheduler::clear()
+    {
+        for(auto & system : mSystems){
+            system.removed = true;
+        }
+        mAdded.clear();
+        mDirty = true;
+    }
+
+    void SystemScheduler::rebuild()
+    {
+        //running systems are referenced by index, compact once they are done
+        if(mRunning)
+            return;
+        for(auto & system : mAdded){
+            mSystems.push_back(std::move(system));
+        }
+        mAdded.clear();
+        mSystems.erase(std::remove_if(mSystems.begin(), mSystems.end(), [](const System& system){
+            return system.removed;
+        }), mSystems.end());
+
+        mStages.clear();
+        for(size_t i = 0; i < mSystems.size(); ++i){
+            auto& system = mSystems[i];
+            system.stage = 0;
+            for(size_t j = 0; j < i; ++j){
+                if(system.access.conflicts(mSystems[j].access))
+                    system.stage = std::max(system.stage, mSystems[j].stage + 1);
+            }
+            if(system.stage >= mStages.size()){
+                mStages.resize(system.stage + 1);
+            }
+            mStages[system.stage].push_back(i);
+        }
+        mDirty = false;
+    }
+
+    size_t SystemScheduler::getNumStages()
+    {
+        if(mDirty)
+            rebuild();
+        return mStages.size();
+    }
+
+    const std::vector<size_t>& SystemScheduler::getStage(size_t stage)
+    {
+        if(mDirty)
+            rebuild();
+        return mStages[stage];
+    }
+
+    std::string SystemScheduler::describe()
+    {
+        if(mDirty)
+            rebuild();
+        std::ostringstream out;
+        for(size_t stage = 0; stage < mStages.size(); ++stage){
+            out << "stage " << stage << ":";
+            for(auto index : mStages[stage]){
+                auto& system = mSystems[index];
+                out << " " << system.name << (system.access.isMainThread() ? "*" : "");
+            }
+            out << "\n";
+        }
+        return out.str();
+    }
+
+    void SystemScheduler::runSystem(System& system, const IEventRef& update, DelegateProfiler* profiler)
+    {
+        if(system.removed)
+            return;
+        EventStatus status;
+        if(profiler){
+            Timer timer(true);
+            status = system.delegate(update);
+            auto milliseconds = static_cast<float>(timer.getMilliseconds());
+            std::unique_lock<std::mutex> lock(mProfilerMutex);
+            if(!profiler->contains(system.delegate))
+                profiler->setName(system.delegate, system.name);
+            if(profiler->record(system.delegate, milliseconds)){
+                auto timing = profiler->getTiming(system.delegate);
+                lock.unlock();
+                if(mEvents)
+                    mEvents->queueThreadedEvent<DelegateOverBudget>(update->getType(), timing);
+            }
+        }else{
+            status = system.delegate(update);
+        }
+        switch(status){
+            case EventStatus::FAILED:{
+                MS_LOG_ERROR("Scheduled system failed: " + system.name);
+            }break;
+            case EventStatus::REMOVE_THIS_DELEGATE:{
+                //flags only, the schedule is rebuilt on the calling thread
+                system.removed = true;
+            }break;
+            default: break;
+        }
+    }
+
+    void SystemScheduler::run(const IEventRef& update)
+    {
+        if(mDirty)
+            rebuild();
+        auto profiler = mProfiler && mProfiler->isEnabled() ? mProfiler : nullptr;
+        mRunning = true;
+        for(auto & stage : mStages){
+            size_t workers = 0;
+            if(mPool && mPool->getNumWorkers() > 0){
+                for(auto index : stage){
+                    if(!mSystems[index].access.isMainThread())
+                        ++workers;
+                }
+            }
+            //nothing to overlap with, keep it on this thread
+            if(workers == 0 || stage.size() == 1){
+                for(auto index : stage){
+                    runSystem(mSystems[index], update, profiler);
+                }
+                continue;
+            }
+
+            std::mutex mutex;
+            std::condition_variable finished;
+            size_t remaining = workers;
+            for(auto index : stage){
+                auto& system = mSystems[index];
+                if(system.access.isMainThread())
+                    continue;
+                mPool->submit([&, index](){
+                    runSystem(mSystems[index], update, profiler);
+                    //decremented under the lock so the waiter can't return while this still touches the stack
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if(--remaining == 0)
+                        finished.notify_all();
+                });
+            }
+            for(auto index : stage){
+                if(mSystems[index].access.isMainThread())
+                    runSystem(mSystems[index], update, profiler);
+            }
+            std::unique_lock<std::mutex> lock(mutex);
+            finished.wait(lock, [&](){ return remaining == 0; });
+        }
+        mRunning = false;
+
+        //systems that returned REMOVE_THIS_DELEGATE
+        for(auto & system : mSystems){
+            if(system.removed){
+                mDirty = true;
+                break;
+            }
+        }
+    }
+
+}//end namespace mediasystem
@@ -0,0 +1,129 @@
+//
+//  SystemScheduler.h
+//  ofxMediaSystem
+//
+
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include "mediasystem/events/EventManager.h"
+#include "mediasystem/core/ComponentSignature.h"
+#include "mediasystem/util/ThreadPool.hpp"
+#include "mediasystem/util/TupleHelpers.hpp"
+
+namespace mediasystem {
+
+    //The components a scheduled system touches. Two systems that don't write anything the other
+    //reads or writes may run at the same time. Systems run on the main thread unless they opt in to
+    //the workers with onWorkers().
+    class SystemAccess {
+    public:
+
+        template<typename...ComponentTypes>
+        SystemAccess& read(){
+            int l[] = {0, (mReads.set(type_index<ComponentTypes>()),0)...};
+            UNUSED_VARIABLE(l);
+            return *this;
+        }
+
+        template<typename...ComponentTypes>
+        SystemAccess& write(){
+            int l[] = {0, (mWrites.set(type_index<ComponentTypes>()),0)...};
+            UNUSED_VARIABLE(l);
+            return *this;
+        }
+
+        //runs on the thread that updates the scene, ie. anything calling GL or openFrameworks. The default.
+        inline SystemAccess& onMainThread(){ mMainThread = true; return *this; }
+        //may run on the scheduler's pool, only for systems that stick to the worker safe calls below
+        inline SystemAccess& onWorkers(){ mMainThread = false; return *this; }
+        //runs alone, ie. anything creating or destroying entities and components
+        inline SystemAccess& exclusive(){ mExclusive = true; return *this; }
+
+        SystemAccess& merge(const SystemAccess& other);
+        bool conflicts(const SystemAccess& other) const;
+
+        inline const ComponentSignature& getReads() const { return mReads; }
+        inline const ComponentSignature& getWrites() const { return mWrites; }
+        inline bool isMainThread() const { return mMainThread; }
+        inline bool isExclusive() const { return mExclusive; }
+
+    private:
+        ComponentSignature mReads;
+        ComponentSignature mWrites;
+        bool mMainThread{true};
+        bool mExclusive{false};
+    };
+
+    //Runs the scene's scheduled systems once per update, after the Update delegates. Systems are split
+    //into stages, a system lands in the stage after the last earlier system it conflicts with, so
+    //conflicting systems keep their registration order. The systems of a stage run concurrently on the
+    //thread pool, main thread ones on the calling thread. Without a pool everything runs in
+    //registration order on the calling thread.
+    //
+    //A system may only touch the components it declared, main thread ones included since they overlap
+    //with the workers. Off the main thread events have to go through queueThreadedEvent, and
+    //Scene::markChanged, Scene::markTransformDirty (so Entity's transform setters) and queueEvent are
+    //main thread only, they write the change logs, the transform dirty list and the event queue unlocked.
+    class SystemScheduler {
+    public:
+
+        struct System {
+            std::string name;
+            SystemAccess access;
+            EventDelegate delegate;
+            size_t stage{0};
+            bool removed{false};
+        };
+
+        SystemScheduler() = default;
+
+        //non copyable
+        SystemScheduler(const SystemScheduler&) = delete;
+        SystemScheduler& operator=(const SystemScheduler&) = delete;
+
+        //delegate is called with the scene's Update event. Both take effect after the current update
+        //when called from a running system, call them from the main thread.
+        void add(std::string name, SystemAccess access, EventDelegate delegate);
+        void remove(EventDelegate delegate);
+        void clear();
+
+        //nullptr runs everything on the calling thread. The pool must outlive the scheduler or be unset.
+        inline void setThreadPool(ThreadPool* pool){ mPool = pool; }
+        inline ThreadPool* getThreadPool() const { return mPool; }
+
+        //Times each system into profiler while it is enabled, under the system's name unless it was given
+        //another one. A system over its budget queues a DelegateOverBudget on events, through
+        //queueThreadedEvent since workers time themselves. Both must outlive the scheduler or be unset.
+        void setProfiler(DelegateProfiler* profiler, EventManager* events);
+
+        void run(const IEventRef& update);
+
+        //the schedule as of the last run or rebuild
+        size_t getNumStages();
+        //indices into getSystem, registration order
+        const std::vector<size_t>& getStage(size_t stage);
+        inline size_t getNumSystems() const { return mSystems.size(); }
+        inline const System& getSystem(size_t index) const { return mSystems[index]; }
+        //one line per stage, main thread systems are marked with a *
+        std::string describe();
+
+    private:
+
+        void rebuild();
+        void runSystem(System& system, const IEventRef& update, DelegateProfiler* profiler);
+
+        std::vector<System> mSystems;
+        std::vector<System> mAdded; //added while running
+        std::vector<std::vector<size_t>> mStages;
+        ThreadPool* mPool{nullptr};
+        DelegateProfiler* mProfiler{nullptr};
+        EventManager* mEvents{nullptr};
+        std::mutex mProfilerMutex; //workers record in parallel
+        bool mDirty{false};
+        bool mRunning{false};
+    };
+
+}//end namespace mediasystem
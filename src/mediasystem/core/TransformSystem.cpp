@@ -0,0 +1,362 @@
+//
+//  TransformSystem.cpp
+//  ofxMediaSystem
+//
+
+#include "TransformSystem.h"
+#include <cstring>
+#include <algorithm>
+#include "mediasystem/core/Entity.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define MS_TRANSFORM_SSE
+#endif
+
+namespace mediasystem {
+
+    namespace {
+
+        //out = a * b, column major, out must not alias a or b
+        inline void multiply(const glm::mat4& a, const glm::mat4& b, glm::mat4& out){
+#if defined(MS_TRANSFORM_SSE)
+            auto pa = &a[0][0];
+            auto pb = &b[0][0];
+            auto po = &out[0][0];
+            auto a0 = _mm_loadu_ps(pa);
+            auto a1 = _mm_loadu_ps(pa + 4);
+            auto a2 = _mm_loadu_ps(pa + 8);
+            auto a3 = _mm_loadu_ps(pa + 12);
+            for(int column = 0; column < 4; ++column){
+                auto col = pb + column * 4;
+                auto r = _mm_mul_ps(a0, _mm_set1_ps(col[0]));
+                r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_set1_ps(col[1])));
+                r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_set1_ps(col[2])));
+                r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_set1_ps(col[3])));
+                _mm_storeu_ps(po + column * 4, r);
+            }
+#else
+            out = a * b;
+#endif
+        }
+
+    }
+
+    TransformSystem::TransformSystem(Scene& scene):
+        mScene(scene),
+        mRows(scene.getAllocator<size_t>()),
+        mEntityIds(scene.getAllocator<size_t>()),
+        mParents(scene.getAllocator<size_t>()),
+        mSubtreeEnds(scene.getAllocator<size_t>()),
+        mLocal(scene.getAllocator<glm::mat4>()),
+        mWorld(scene.getAllocator<glm::mat4>()),
+        mOrientations(scene.getAllocator<glm::quat>()),
+        mScales(scene.getAllocator<glm::vec3>()),
+        mLocalDirty(scene.getAllocator<uint8_t>()),
+        mDirtyRows(scene.getAllocator<size_t>())
+    {
+        mScene.mTransforms = this;
+        mScene.addDelegate<Draw>(EventDelegate::create<TransformSystem, &TransformSystem::onDraw>(this), "TransformSystem");
+        mScene.addDelegate<NewEntity>(EventDelegate::create<TransformSystem, &TransformSystem::onNewEntity>(this));
+        mScene.addDelegate<NewEntities>(EventDelegate::create<TransformSystem, &TransformSystem::onNewEntities>(this));
+        mScene.addDelegate<DestroyEntities>(EventDelegate::create<TransformSystem, &TransformSystem::onDestroyEntities>(this));
+    }
+
+    TransformSystem::~TransformSystem()
+    {
+        if(mScene.mTransforms == this)
+            mScene.mTransforms = nullptr;
+        mScene.removeDelegate<Draw>(EventDelegate::create<TransformSystem, &TransformSystem::onDraw>(this));
+        mScene.removeDelegate<NewEntity>(EventDelegate::create<TransformSystem, &TransformSystem::onNewEntity>(this));
+        mScene.removeDelegate<NewEntities>(EventDelegate::create<TransformSystem, &TransformSystem::onNewEntities>(this));
+        mScene.removeDelegate<DestroyEntities>(EventDelegate::create<TransformSystem, &TransformSystem::onDestroyEntities>(this));
+    }
+
+    void TransformSystem::setThreadPool(ThreadPool* pool)
+    {
+        mPool = pool;
+        partition();
+    }
+
+    void TransformSystem::setMinRowsPerTask(size_t rows)
+    {
+        mMinRowsPerTask = std::max<size_t>(1, rows);
+        partition();
+    }
+
+    void TransformSystem::rebuild()
+    {
+        mRows.clear();
+        mEntityIds.clear();
+        mParents.clear();
+
+        auto addRow = [this](size_t entity_id, size_t parent){
+            auto index = getEntityIndex(entity_id);
+            if(index >= mRows.size()){
+                mRows.resize(index + 1, NO_ROW);
+            }
+            mRows[index] = mEntityIds.size();
+            mEntityIds.push_back(entity_id);
+            mParents.push_back(parent);
+        };
+
+        //depth first so every parent precedes its children and every subtree is contiguous
+        auto graphs = mScene.view<EntityGraph>();
+        graphs.each([&](size_t entity_id, EntityGraph& root){
+            if(root.hasParent())
+                return;
+            for(auto & graph : root.getSubtree()){
+                auto parent = graph.hasParent() ? mRows[getEntityIndex(graph.parent)] : NO_ROW;
+                addRow(graph.self.getId(), parent);
+            }
+        });
+
+        auto count = mEntityIds.size();
+        mSubtreeEnds.resize(count);
+        for(size_t row = 0; row < count; ++row){
+            mSubtreeEnds[row] = row + 1;
+        }
+        for(size_t row = count; row-- > 0;){
+            auto parent = mParents[row];
+            if(parent != NO_ROW)
+                mSubtreeEnds[parent] = std::max(mSubtreeEnds[parent], mSubtreeEnds[row]);
+        }
+
+        mLocal.resize(count);
+        mWorld.resize(count);
+        mOrientations.resize(count);
+        mScales.resize(count);
+        mLocalDirty.assign(count, 0);
+        mDirtyRows.clear();
+        mNumRetired = 0;
+        mHierarchyDirty = false;
+        partition();
+    }
+
+    void TransformSystem::appendRoot(size_t entity_id)
+    {
+        //already sorted in by a rebuild
+        if(getRow(entity_id) != NO_ROW)
+            return;
+        auto graph = EntityGraph::find(mScene.getStorage<EntityGraph>(), entity_id);
+        if(!graph)
+            return;
+        //linked up since it was created, it has to be sorted with its parent or children
+        if(graph->hasParent() || graph->firstChild != INVALID_ENTITY_ID){
+            markHierarchyDirty();
+            return;
+        }
+        auto index = getEntityIndex(entity_id);
+        if(index >= mRows.size()){
+            mRows.resize(index + 1, NO_ROW);
+        }
+        auto row = mEntityIds.size();
+        mRows[index] = row;
+        mEntityIds.push_back(entity_id);
+        mParents.push_back(NO_ROW);
+        mSubtreeEnds.push_back(row + 1);
+        mLocal.emplace_back();
+        mWorld.emplace_back();
+        mOrientations.emplace_back();
+        mScales.emplace_back();
+        mLocalDirty.push_back(1);
+        mDirtyRows.push_back(row);
+        mPartitionDirty = true;
+    }
+
+    void TransformSystem::partition()
+    {
+        mPartitionDirty = false;
+        mSerialRows.clear();
+        mTasks.clear();
+        auto count = mEntityIds.size();
+        if(!mPool || mPool->getNumWorkers() == 0 || count < mMinRowsPerTask * 2)
+            return;
+
+        //a few tasks per thread so uneven subtrees still balance
+        auto target = std::max(mMinRowsPerTask, count / (mPool->getConcurrency() * 4));
+        size_t row = 0;
+        while(row < count){
+            auto end = mSubtreeEnds[row];
+            if(end - row > target){
+                //too big, compute the root up front and descend into its children
+                mSerialRows.push_back(row);
+                ++row;
+                continue;
+            }
+            //merge with the previous range if it is adjacent and still small
+            if(!mTasks.empty() && mTasks.back().second == row && end - mTasks.back().first <= target){
+                mTasks.back().second = end;
+            }else{
+                mTasks.emplace_back(row, end);
+            }
+            row = end;
+        }
+    }
+
+    void TransformSystem::updateRow(size_t row, ComponentView<ofNode>& nodes)
+    {
+        auto entity_id = mEntityIds[row];
+        if(!nodes.contains(entity_id))
+            return;
+        auto& node = nodes.get<ofNode>(entity_id);
+        auto parent = mParents[row];
+        mLocal[row] = node.getLocalTransformMatrix();
+        if(parent != NO_ROW){
+            multiply(mWorld[parent], mLocal[row], mWorld[row]);
+            mOrientations[row] = mOrientations[parent] * node.getOrientationQuat();
+            mScales[row] = mScales[parent] * node.getScale();
+        }else{
+            mWorld[row] = mLocal[row];
+            mOrientations[row] = node.getOrientationQuat();
+            mScales[row] = node.getScale();
+        }
+    }
+
+    void TransformSystem::detectUnmarked(ComponentView<ofNode>& nodes)
+    {
+        for(size_t row = 0; row < mEntityIds.size(); ++row){
+            if(mLocalDirty[row])
+                continue;
+            auto entity_id = mEntityIds[row];
+            if(!nodes.contains(entity_id))
+                continue;
+            auto& local = nodes.get<ofNode>(entity_id).getLocalTransformMatrix();
+            if(std::memcmp(&local, &mLocal[row], sizeof(glm::mat4)) != 0){
+                mLocalDirty[row] = 1;
+                mDirtyRows.push_back(row);
+            }
+        }
+    }
+
+    void TransformSystem::updateRange(size_t begin, size_t end, ComponentView<ofNode>& nodes)
+    {
+        if(mTasks.empty() || end - begin < mMinRowsPerTask * 2){
+            for(auto row = begin; row < end; ++row){
+                updateRow(row, nodes);
+            }
+            return;
+        }
+        //a range is a whole subtree, the serial rows inside it are the roots it was split at and the
+        //tasks clipped to it are whole subtrees under them
+        for(auto row : mSerialRows){
+            if(row >= begin && row < end)
+                updateRow(row, nodes);
+        }
+        mRangeTasks.clear();
+        for(auto & task : mTasks){
+            auto first = std::max(task.first, begin);
+            auto last = std::min(task.second, end);
+            if(first < last)
+                mRangeTasks.emplace_back(first, last);
+        }
+        //tasks only write their own rows and only read rows of their own subtree or serial rows
+        mPool->parallelFor(mRangeTasks.size(), [&](size_t task){
+            for(auto row = mRangeTasks[task].first; row < mRangeTasks[task].second; ++row){
+                updateRow(row, nodes);
+            }
+        });
+    }
+
+    void TransformSystem::update()
+    {
+        //rows moved around, everything is recomputed
+        if(mHierarchyDirty)
+            rebuild();
+        else if(mPartitionDirty)
+            partition();
+
+        auto nodes = mScene.view<ofNode>();
+        if(!mAllDirty && mDetectUnmarked)
+            detectUnmarked(nodes);
+        if(mAllDirty){
+            updateRange(0, mEntityIds.size(), nodes);
+            mAllDirty = false;
+        }else if(!mDirtyRows.empty()){
+            //each dirty row brings its subtree along, dirty rows inside a subtree already done are skipped
+            std::sort(mDirtyRows.begin(), mDirtyRows.end());
+            size_t done = 0;
+            for(auto row : mDirtyRows){
+                if(row < done)
+                    continue;
+                done = mSubtreeEnds[row];
+                updateRange(row, done, nodes);
+            }
+        }
+        for(auto row : mDirtyRows){
+            mLocalDirty[row] = 0;
+        }
+        mDirtyRows.clear();
+    }
+
+    EventStatus TransformSystem::onDraw(const IEventRef& event)
+    {
+        update();
+        return EventStatus::SUCCESS;
+    }
+
+    EventStatus TransformSystem::onNewEntity(const IEventRef& event)
+    {
+        //the next rebuild sorts it in anyway
+        if(mHierarchyDirty)
+            return EventStatus::SUCCESS;
+        if(auto entity = std::static_pointer_cast<NewEntity>(event)->getEntity().lock())
+            appendRoot(entity->getId());
+        return EventStatus::SUCCESS;
+    }
+
+    EventStatus TransformSystem::onNewEntities(const IEventRef& event)
+    {
+        if(mHierarchyDirty)
+            return EventStatus::SUCCESS;
+        for(auto entity_id : std::static_pointer_cast<NewEntities>(event)->getEntityIds()){
+            appendRoot(entity_id);
+            if(mHierarchyDirty)
+                break;
+        }
+        return EventStatus::SUCCESS;
+    }
+
+    EventStatus TransformSystem::onDestroyEntities(const IEventRef& event)
+    {
+        if(mHierarchyDirty)
+            return EventStatus::SUCCESS;
+        auto& ids = std::static_pointer_cast<DestroyEntities>(event)->getEntityIds();
+        mRetiring.clear();
+        for(auto entity_id : ids){
+            auto row = getRow(entity_id);
+            if(row == NO_ROW)
+                continue;
+            mRows[getEntityIndex(entity_id)] = NO_ROW;
+            mEntityIds[row] = INVALID_ENTITY_ID;
+            mRetiring.push_back(row);
+        }
+        mNumRetired += mRetiring.size();
+        //compacting costs a rebuild, only worth it once most rows are dead
+        if(mNumRetired > mEntityIds.size() / 2){
+            markHierarchyDirty();
+            return EventStatus::SUCCESS;
+        }
+        //the live children of retired rows become roots, their subtrees stay contiguous where they are.
+        //Ancestors keep their old subtree end, which only means a bit more is recomputed under them.
+        std::sort(mRetiring.begin(), mRetiring.end());
+        size_t done = 0;
+        for(auto retired : mRetiring){
+            if(retired < done)
+                continue;
+            done = mSubtreeEnds[retired];
+            for(auto row = retired + 1; row < done; ++row){
+                auto parent = mParents[row];
+                if(mEntityIds[row] != INVALID_ENTITY_ID && parent != NO_ROW && mEntityIds[parent] == INVALID_ENTITY_ID){
+                    mParents[row] = NO_ROW;
+                    if(!mLocalDirty[row]){
+                        mLocalDirty[row] = 1;
+                        mDirtyRows.push_back(row);
+                    }
+                }
+            }
+        }
+        return EventStatus::SUCCESS;
+    }
+
+}//end namespace mediasystem
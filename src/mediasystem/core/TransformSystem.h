@@ -0,0 +1,153 @@
+//
+//  TransformSystem.h
+//  ofxMediaSystem
+//
+
+#pragma once
+
+#include <vector>
+#include <limits>
+#include "ofMain.h"
+#include "mediasystem/core/Scene.h"
+#include "mediasystem/util/ThreadPool.hpp"
+
+namespace mediasystem {
+
+    //Caches the world transform of every entity in flat arrays in depth first order, so a parent
+    //is always computed before its children and every subtree is a contiguous range of rows.
+    //The hierarchy comes from EntityGraph, the local transforms from each entity's ofNode.
+    //
+    //Rows are flagged dirty by Entity's transform setters and Scene::markChanged<ofNode>, and only
+    //the subtrees under dirty rows are recomputed. To pick up edits made on an ofNode directly, every
+    //row that wasn't flagged also has its ofNode's local matrix compared to the cached one, which is
+    //O(N) per update however little changed. Apps that always mark their edits should turn that off
+    //with setDetectUnmarked(false).
+    //
+    //New entities are appended as root rows and destroyed ones are retired in place, their children
+    //becoming roots, so entity churn only computes the rows it touches. Reparenting re-sorts every row,
+    //as does retiring more rows than are live.
+    //
+    //With a ThreadPool set, subtrees bigger than the task size are split, their root rows are computed
+    //first on the calling thread and their children become separate ranges that run in parallel.
+    //Results are identical to the single threaded path, which is used when no pool is set or the work
+    //is small.
+    //
+    //The cache is refreshed before the scene's Update delegates and systems run and again at the start
+    //of Draw, create the system before anything that draws so it runs first. A row that is dirty, or
+    //has a dirty ancestor, reads as not cached until the next refresh and reads fall back to ofNode.
+    //Unmarked edits are only seen at the next refresh, until then the row reads as cached.
+    class TransformSystem {
+    public:
+
+        TransformSystem(Scene& scene);
+        ~TransformSystem();
+
+        //recomputes the world transforms of dirty rows and their descendants
+        void update();
+
+        //nullptr computes everything on the calling thread. The pool must outlive the system or be unset.
+        void setThreadPool(ThreadPool* pool);
+        inline ThreadPool* getThreadPool() const { return mPool; }
+        //lower bound on the rows in a parallel task, smaller scenes are not worth splitting up
+        void setMinRowsPerTask(size_t rows);
+        inline size_t getNumTasks() const { return mTasks.size(); }
+        //compares the local matrix of every row that wasn't marked in each update, O(N), on by default
+        inline void setDetectUnmarked(bool detect){ mDetectUnmarked = detect; }
+        inline bool isDetectingUnmarked() const { return mDetectUnmarked; }
+
+        //the entity's local transform changed, it and its descendants are recomputed in the next update
+        inline void markDirty(size_t entity_id){
+            auto row = getRow(entity_id);
+            if(row == NO_ROW || mLocalDirty[row])
+                return;
+            mLocalDirty[row] = 1;
+            mDirtyRows.push_back(row);
+        }
+        //recomputes every row in the next update
+        inline void markDirty(){ mAllDirty = true; }
+        inline void markHierarchyDirty(){ mAllDirty = true; mHierarchyDirty = true; }
+
+        //true if the cached values for the entity are current
+        inline bool isCached(size_t entity_id) const {
+            if(mAllDirty)
+                return false;
+            auto row = getRow(entity_id);
+            if(row == NO_ROW)
+                return false;
+            for(; row != NO_ROW; row = mParents[row]){
+                if(mLocalDirty[row])
+                    return false;
+            }
+            return true;
+        }
+
+        //only valid while isCached(entity_id)
+        inline const glm::mat4& getGlobalTransformMatrix(size_t entity_id) const { return mWorld[getRow(entity_id)]; }
+        inline glm::vec3 getGlobalPosition(size_t entity_id) const {
+            auto& world = mWorld[getRow(entity_id)];
+            return glm::vec3(world[3][0], world[3][1], world[3][2]);
+        }
+        inline const glm::quat& getGlobalOrientation(size_t entity_id) const { return mOrientations[getRow(entity_id)]; }
+        inline const glm::vec3& getGlobalScale(size_t entity_id) const { return mScales[getRow(entity_id)]; }
+
+        inline size_t size() const { return mEntityIds.size() - mNumRetired; }
+
+    private:
+
+        static constexpr size_t NO_ROW = std::numeric_limits<size_t>::max();
+
+        inline size_t getRow(size_t entity_id) const {
+            auto index = getEntityIndex(entity_id);
+            if(index < mRows.size()){
+                auto row = mRows[index];
+                if(row != NO_ROW && mEntityIds[row] == entity_id)
+                    return row;
+            }
+            return NO_ROW;
+        }
+
+        //sorts every entity depth first and resolves parent rows
+        void rebuild();
+        //a new entity without parent or children goes last, a root there keeps the rows depth first
+        void appendRoot(size_t entity_id);
+        //splits the rows into serial subtree roots and parallel ranges
+        void partition();
+        //rows [begin, end) in order, in parallel where the partition allows
+        void updateRange(size_t begin, size_t end, ComponentView<ofNode>& nodes);
+        void updateRow(size_t row, ComponentView<ofNode>& nodes);
+        //flags rows whose ofNode was edited without being marked
+        void detectUnmarked(ComponentView<ofNode>& nodes);
+
+        EventStatus onDraw(const IEventRef& event);
+        EventStatus onNewEntity(const IEventRef& event);
+        EventStatus onNewEntities(const IEventRef& event);
+        //sent before the entities are unlinked from their parents and children
+        EventStatus onDestroyEntities(const IEventRef& event);
+
+        Scene& mScene;
+        std::vector<size_t, Allocator<size_t>> mRows; //entity index -> row
+        //one row per entity, parents before children
+        std::vector<size_t, Allocator<size_t>> mEntityIds;
+        std::vector<size_t, Allocator<size_t>> mParents; //parent row or NO_ROW
+        std::vector<size_t, Allocator<size_t>> mSubtreeEnds; //one past the row's last descendant
+        std::vector<glm::mat4, Allocator<glm::mat4>> mLocal;
+        std::vector<glm::mat4, Allocator<glm::mat4>> mWorld;
+        std::vector<glm::quat, Allocator<glm::quat>> mOrientations;
+        std::vector<glm::vec3, Allocator<glm::vec3>> mScales;
+        std::vector<uint8_t, Allocator<uint8_t>> mLocalDirty; //local transform changed since the last update
+        std::vector<size_t, Allocator<size_t>> mDirtyRows; //rows flagged in mLocalDirty
+        std::vector<size_t> mRetiring; //rows of the entities being destroyed
+        size_t mNumRetired{0}; //rows of destroyed entities, INVALID_ENTITY_ID until the next rebuild
+        bool mAllDirty{true};
+        bool mHierarchyDirty{true};
+        bool mPartitionDirty{false};
+        bool mDetectUnmarked{true};
+
+        ThreadPool* mPool{nullptr};
+        size_t mMinRowsPerTask{1024};
+        std::vector<size_t> mSerialRows; //computed in order before the tasks
+        std::vector<std::pair<size_t, size_t>> mTasks; //[begin, end) row ranges
+        std::vector<std::pair<size_t, size_t>> mRangeTasks; //mTasks clipped to the range being updated
+    };
+
+}//end namespace mediasystem
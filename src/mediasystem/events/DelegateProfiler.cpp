@@ -0,0 +1,162 @@
+//
+//  DelegateProfiler.cpp
+//  ofxMediaSystem
+//
+
+#include "DelegateProfiler.h"
+#include <algorithm>
+#include <cmath>
+
+namespace mediasystem {
+
+    void DelegateProfiler::Entry::add(float milliseconds)
+    {
+        if(timing.calls++ == 0)
+            average = ExponentialMovingAverage<float>(0.1f, milliseconds);
+        timing.last = milliseconds;
+        timing.average = average.filter(milliseconds);
+        timing.max = std::max(timing.max, milliseconds);
+        samples[next] = milliseconds;
+        next = (next + 1) % WINDOW;
+    }
+
+    DelegateTiming DelegateProfiler::Entry::getTiming() const
+    {
+        auto ret = timing;
+        auto count = std::min(timing.calls, WINDOW);
+        if(count == 0)
+            return ret;
+        std::vector<float> window(samples.begin(), samples.begin() + count);
+        auto rank = static_cast<size_t>(std::ceil(count * 0.99f)) - 1;
+        std::nth_element(window.begin(), window.begin() + rank, window.end());
+        ret.p99 = window[rank];
+        return ret;
+    }
+
+    void DelegateProfiler::setName(const EventDelegate& delegate, std::string name)
+    {
+        for(auto & entry : mEntries){
+            if(entry.delegate == delegate){
+                entry.timing.name = std::move(name);
+                return;
+            }
+        }
+        //named up front, it doesn't take a number
+        mEntries.emplace_back();
+        mEntries.back().delegate = delegate;
+        mEntries.back().timing.name = std::move(name);
+    }
+
+    bool DelegateProfiler::contains(const EventDelegate& delegate) const
+    {
+        return std::any_of(mEntries.begin(), mEntries.end(), [&](const Entry& entry){
+            return entry.delegate == delegate;
+        });
+    }
+
+    void DelegateProfiler::setBudget(const EventDelegate& delegate, float milliseconds)
+    {
+        getEntry(delegate).timing.budget = std::max(milliseconds, 0.f);
+    }
+
+    void DelegateProfiler::remove(const EventDelegate& delegate)
+    {
+        auto found = std::find_if(mEntries.begin(), mEntries.end(), [&](const Entry& entry){
+            return entry.delegate == delegate;
+        });
+        if(found != mEntries.end())
+            mEntries.erase(found);
+    }
+
+    void DelegateProfiler::reset()
+    {
+        for(auto & entry : mEntries){
+            Entry fresh;
+            fresh.delegate = entry.delegate;
+            fresh.timing.name = std::move(entry.timing.name);
+            fresh.timing.budget = entry.timing.budget;
+            entry = std::move(fresh);
+        }
+        mDispatch = Entry();
+        mDispatching = false;
+    }
+
+    void DelegateProfiler::clear()
+    {
+        mEntries.clear();
+        mDispatch = Entry();
+        mNumSeen = 0;
+        mDispatching = false;
+    }
+
+    bool DelegateProfiler::record(const EventDelegate& delegate, float milliseconds)
+    {
+        auto& entry = getEntry(delegate);
+        entry.add(milliseconds);
+        if(entry.timing.budget > 0.f && milliseconds > entry.timing.budget){
+            ++entry.timing.overBudget;
+            return true;
+        }
+        return false;
+    }
+
+    void DelegateProfiler::recordDispatch(float milliseconds)
+    {
+        mDispatch.add(milliseconds);
+    }
+
+    void DelegateProfiler::beginDispatch()
+    {
+        mDispatching = true;
+        mDispatchTimer.start();
+    }
+
+    void DelegateProfiler::endDispatch()
+    {
+        if(!mDispatching)
+            return;
+        mDispatching = false;
+        recordDispatch(static_cast<float>(mDispatchTimer.getMilliseconds()));
+    }
+
+    DelegateTiming DelegateProfiler::getTiming(const EventDelegate& delegate) const
+    {
+        for(auto & entry : mEntries){
+            if(entry.delegate == delegate)
+                return entry.getTiming();
+        }
+        return DelegateTiming();
+    }
+
+    std::vector<DelegateTiming> DelegateProfiler::getTimings() const
+    {
+        std::vector<DelegateTiming> ret;
+        ret.reserve(mEntries.size());
+        for(auto & entry : mEntries){
+            ret.push_back(entry.getTiming());
+        }
+        return ret;
+    }
+
+    DelegateTiming DelegateProfiler::getDispatchTiming() const
+    {
+        auto ret = mDispatch.getTiming();
+        ret.name = "dispatch";
+        return ret;
+    }
+
+    DelegateProfiler::Entry& DelegateProfiler::getEntry(const EventDelegate& delegate)
+    {
+        //a handful of systems listen to any one event, a scan beats hashing the delegate
+        for(auto & entry : mEntries){
+            if(entry.delegate == delegate)
+                return entry;
+        }
+        mEntries.emplace_back();
+        auto& entry = mEntries.back();
+        entry.delegate = delegate;
+        entry.timing.name = "delegate " + std::to_string(mNumSeen++);
+        return entry;
+    }
+
+}//end namespace mediasystem
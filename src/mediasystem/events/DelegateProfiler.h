@@ -0,0 +1,106 @@
+//
+//  DelegateProfiler.h
+//  ofxMediaSystem
+//
+
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+#include "mediasystem/events/IEvent.h"
+#include "mediasystem/events/Delegate.h"
+#include "mediasystem/util/EstimatedMovingAverage.hpp"
+#include "mediasystem/util/BasicTimer.hpp"
+
+namespace mediasystem {
+
+    enum class EventStatus;
+    using EventDelegate = SA::delegate<EventStatus(const IEventRef&)>;
+
+    //How long a delegate took to handle an event, in milliseconds
+    struct DelegateTiming {
+        std::string name;
+        size_t calls{0};
+        float last{0.f};
+        float average{0.f}; //exponential moving average
+        float p99{0.f}; //over the last DelegateProfiler::WINDOW calls
+        float max{0.f};
+        float budget{0.f}; //0 if it has none
+        size_t overBudget{0}; //calls that took longer than the budget
+    };
+
+    //queued by an EventManager each time a profiled delegate takes longer than its budget
+    class DelegateOverBudget : public Event<DelegateOverBudget> {
+    public:
+        DelegateOverBudget(type_id_t eventType, const DelegateTiming& timing):mEventType(eventType),mTiming(timing){}
+        //the event the delegate was handling, ie. type_id<Update>
+        inline type_id_t getEventType() const { return mEventType; }
+        inline const DelegateTiming& getTiming() const { return mTiming; }
+    private:
+        type_id_t mEventType;
+        DelegateTiming mTiming;
+    };
+
+    //Per delegate timings for one event type, see EventManager::profileDelegates. Names and budgets
+    //can be given before profiling is turned on, delegates without a name are numbered in the order
+    //they were first seen.
+    class DelegateProfiler {
+    public:
+
+        static constexpr size_t WINDOW = 256;
+
+        inline void setEnabled(bool enabled){ mEnabled = enabled; }
+        inline bool isEnabled() const { return mEnabled; }
+
+        void setName(const EventDelegate& delegate, std::string name);
+        //named, timed or given a budget before
+        bool contains(const EventDelegate& delegate) const;
+        void setBudget(const EventDelegate& delegate, float milliseconds);
+        void remove(const EventDelegate& delegate);
+        //clears the samples, names and budgets are kept
+        void reset();
+        //forgets every delegate, profiling stays on or off
+        void clear();
+
+        //returns true if the call went over the delegate's budget
+        bool record(const EventDelegate& delegate, float milliseconds);
+        void recordDispatch(float milliseconds);
+        //An event handled in more than one step, ie. Update going to its delegates, the scheduled systems
+        //and the rated updates, is timed as one dispatch from begin to end. Multicasts in between only
+        //time their delegates.
+        void beginDispatch();
+        void endDispatch();
+        inline bool isDispatching() const { return mDispatching; }
+
+        //p99 is worked out here, a delegate that was never seen gets an empty timing
+        DelegateTiming getTiming(const EventDelegate& delegate) const;
+        //one per delegate in the order they were first seen, p99 is worked out here
+        std::vector<DelegateTiming> getTimings() const;
+        //every delegate together for each dispatch of the event
+        DelegateTiming getDispatchTiming() const;
+
+    private:
+
+        struct Entry {
+            EventDelegate delegate;
+            DelegateTiming timing;
+            ExponentialMovingAverage<float> average{0.1f, 0.f};
+            std::array<float, WINDOW> samples;
+            size_t next{0};
+
+            void add(float milliseconds);
+            DelegateTiming getTiming() const;
+        };
+
+        Entry& getEntry(const EventDelegate& delegate);
+
+        std::vector<Entry> mEntries;
+        Entry mDispatch;
+        Timer mDispatchTimer;
+        size_t mNumSeen{0};
+        bool mEnabled{false};
+        bool mDispatching{false};
+    };
+
+}//end namespace mediasystem
@@ -7,6 +7,7 @@
 
 #include "EventManager.h"
 #include "mediasystem/util/Log.h"
+#include "mediasystem/util/BasicTimer.hpp"
 
 namespace mediasystem {
     
@@ -106,11 +107,36 @@ namespace mediasystem {
     }
     
     EventStatus EventManager::multicast(EventDelegateList& list, const IEventRef& event)
+    {
+        if(!mProfilers.empty()){
+            auto found = mProfilers.find(event->getType());
+            if(found != mProfilers.end() && found->second->isEnabled()){
+                //the caller times the whole dispatch
+                if(found->second->isDispatching())
+                    return multicast(list, event, found->second.get());
+                Timer timer(true);
+                auto ret = multicast(list, event, found->second.get());
+                found->second->recordDispatch(static_cast<float>(timer.getMilliseconds()));
+                return ret;
+            }
+        }
+        return multicast(list, event, nullptr);
+    }
+    
+    EventStatus EventManager::multicast(EventDelegateList& list, const IEventRef& event, DelegateProfiler* profiler)
     {
         auto it = list.begin();
         auto end = list.end();
         while(it != end){
-            auto ret = (*it)(event);
+            EventStatus ret;
+            if(profiler){
+                Timer timer(true);
+                ret = (*it)(event);
+                if(profiler->record(*it, static_cast<float>(timer.getMilliseconds())))
+                    queueEvent<DelegateOverBudget>(event->getType(), profiler->getTiming(*it));
+            }else{
+                ret = (*it)(event);
+            }
             switch(ret){
                 case EventStatus::FAILED:{
                     MS_LOG_ERROR("Event delegate failed during processing of event: " /* todo overload stream operator */);
@@ -128,6 +154,7 @@ namespace mediasystem {
                     return EventStatus::ABORT_ALL_QUEUED_EVENTS_OF_THIS_TYPE;
                 }break;
                 case EventStatus::REMOVE_THIS_DELEGATE:{
+                    forgetDelegate(event->getType(), *it);
                     it = list.erase(it);
                 }break;
                 default: ++it; break;
@@ -148,6 +175,101 @@ namespace mediasystem {
         }
     }
     
+    EventStatus EventManager::invoke(const EventDelegate& delegate, const IEventRef& event)
+    {
+        if(!mProfilers.empty()){
+            auto found = mProfilers.find(event->getType());
+            if(found != mProfilers.end() && found->second->isEnabled()){
+                Timer timer(true);
+                auto ret = delegate(event);
+                if(found->second->record(delegate, static_cast<float>(timer.getMilliseconds())))
+                    queueEvent<DelegateOverBudget>(event->getType(), found->second->getTiming(delegate));
+                return ret;
+            }
+        }
+        return delegate(event);
+    }
+    
+    void EventManager::forgetDelegate(type_id_t type, const EventDelegate& delegate)
+    {
+        auto found = mProfilers.find(type);
+        if(found != mProfilers.end())
+            found->second->remove(delegate);
+        auto settings = mDelegateSettings.find(type);
+        if(settings != mDelegateSettings.end()){
+            auto& list = settings->second;
+            list.erase(std::remove_if(list.begin(), list.end(), [&](const DelegateSetting& setting){
+                return setting.delegate == delegate;
+            }), list.end());
+        }
+    }
+    
+    DelegateProfiler* EventManager::findProfiler(type_id_t type) const
+    {
+        if(mProfilers.empty())
+            return nullptr;
+        auto found = mProfilers.find(type);
+        return found != mProfilers.end() ? found->second.get() : nullptr;
+    }
+    
+    void EventManager::setDelegateName(type_id_t type, const EventDelegate& delegate, std::string name)
+    {
+        if(auto profiler = findProfiler(type)){
+            profiler->setName(delegate, std::move(name));
+        }else{
+            getDelegateSetting(type, delegate).name = std::move(name);
+        }
+    }
+    
+    void EventManager::setDelegateBudget(type_id_t type, const EventDelegate& delegate, float milliseconds)
+    {
+        if(auto profiler = findProfiler(type)){
+            profiler->setBudget(delegate, milliseconds);
+        }else{
+            getDelegateSetting(type, delegate).budget = milliseconds;
+        }
+    }
+    
+    EventManager::DelegateSetting& EventManager::getDelegateSetting(type_id_t type, const EventDelegate& delegate)
+    {
+        auto& list = mDelegateSettings[type];
+        for(auto & setting : list){
+            if(setting.delegate == delegate)
+                return setting;
+        }
+        list.emplace_back();
+        list.back().delegate = delegate;
+        return list.back();
+    }
+    
+    DelegateProfiler& EventManager::getProfiler(type_id_t type)
+    {
+        auto& profiler = mProfilers[type];
+        if(!profiler){
+            profiler.reset(new DelegateProfiler());
+            auto settings = mDelegateSettings.find(type);
+            if(settings != mDelegateSettings.end()){
+                //in the order they were given, so named delegates keep their place in the timings
+                for(auto & setting : settings->second){
+                    if(!setting.name.empty())
+                        profiler->setName(setting.delegate, std::move(setting.name));
+                    if(setting.budget > 0.f)
+                        profiler->setBudget(setting.delegate, setting.budget);
+                }
+                mDelegateSettings.erase(settings);
+            }
+            onProfilerCreated(type, *profiler);
+        }
+        return *profiler;
+    }
+    
+    void EventManager::resetDelegateTimings()
+    {
+        for(auto & profiler : mProfilers){
+            profiler.second->reset();
+        }
+    }
+    
     void EventManager::clearQueues()
     {
         mThreadedQueue.reset();
@@ -161,6 +283,10 @@ namespace mediasystem {
             delegateList.second.clear();
         }
         mEvents.clear();
+        for(auto & profiler : mProfilers){
+            profiler.second->clear();
+        }
+        mDelegateSettings.clear();
     }
     
 }//end namespace mediasystem
@@ -8,6 +8,7 @@
 #pragma once
 
 #include <map>
+#include <memory>
 #include "ofMain.h"
 #include "IEvent.h"
 #include "mediasystem/util/Log.h"
@@ -15,6 +16,7 @@
 #include "mediasystem/util/TimedLockingQueue.hpp"
 #include "MultiCastDelegate.h"
 #include "Delegate.h"
+#include "DelegateProfiler.h"
 #include "mediasystem/util/TypeID.hpp"
 
 namespace mediasystem {
@@ -62,9 +64,12 @@ namespace mediasystem {
         }
         void triggerEvent(const IEventRef& event);
         
+        //name is what the delegate shows up as when EventType is profiled
         template<typename EventType>
-        void addDelegate(EventDelegate delegate){
+        void addDelegate(EventDelegate delegate, const std::string& name = ""){
             static_assert( std::is_base_of<IEvent, EventType>::value, "EventType must derive from IEvent.");
+            if(!name.empty())
+                setDelegateName(type_id<EventType>, delegate, name);
             auto& list = mEvents[type_id<EventType>];
             list.emplace_back(std::move(delegate));
         }
@@ -76,6 +81,7 @@ namespace mediasystem {
             auto found = std::find(list.begin(), list.end(), delegate);
             if(found != list.end()){
                 list.erase(found);
+                forgetDelegate(type_id<EventType>, delegate);
             }else{
                 MS_LOG_WARNING("Attemping to remove an unknown delegate");
             }
@@ -88,12 +94,84 @@ namespace mediasystem {
             return list.size();
         }
         
+        //Times each delegate as it handles EventType, ie. Update or Draw, off until turned on. A delegate
+        //that takes longer than its budget queues a DelegateOverBudget, a budget of 0 removes it. Event
+        //types that were never profiled cost nothing, after that dispatching one costs a map lookup.
+        template<typename EventType>
+        void profileDelegates(bool enabled = true){
+            if(enabled){
+                getProfiler(type_id<EventType>).setEnabled(true);
+            }else if(auto profiler = findProfiler(type_id<EventType>)){
+                profiler->setEnabled(false);
+            }
+        }
+        
+        template<typename EventType>
+        bool isProfilingDelegates() const {
+            auto found = mProfilers.find(type_id<EventType>);
+            return found != mProfilers.end() && found->second->isEnabled();
+        }
+        
+        template<typename EventType>
+        void setDelegateName(const EventDelegate& delegate, std::string name){
+            setDelegateName(type_id<EventType>, delegate, std::move(name));
+        }
+        
+        template<typename EventType>
+        void setDelegateBudget(const EventDelegate& delegate, float milliseconds){
+            setDelegateBudget(type_id<EventType>, delegate, milliseconds);
+        }
+        
+        //empty unless EventType has been profiled
+        template<typename EventType>
+        std::vector<DelegateTiming> getDelegateTimings() const {
+            auto found = mProfilers.find(type_id<EventType>);
+            if(found == mProfilers.end())
+                return std::vector<DelegateTiming>();
+            return found->second->getTimings();
+        }
+        
+        //all of EventType's delegates together per dispatch
+        template<typename EventType>
+        DelegateTiming getDispatchTiming() const {
+            auto found = mProfilers.find(type_id<EventType>);
+            if(found == mProfilers.end())
+                return DelegateTiming();
+            return found->second->getDispatchTiming();
+        }
+        
+        void resetDelegateTimings();
+        
         void clearQueues();
         void clearDelegates();
 
+    protected:
+        
+        //calls a delegate kept outside the delegate lists, timed like the rest while event's type is profiled
+        EventStatus invoke(const EventDelegate& delegate, const IEventRef& event);
+        //drops the delegate's timings, name and budget
+        void forgetDelegate(type_id_t type, const EventDelegate& delegate);
+        //nullptr until the type has been profiled, kept from then on with profiling on or off
+        DelegateProfiler* findProfiler(type_id_t type) const;
+        //called once per event type, the first time it is profiled
+        virtual void onProfilerCreated(type_id_t /*type*/, DelegateProfiler& /*profiler*/){}
+        
     private:
         
-        static EventStatus multicast(EventDelegateList& list, const IEventRef& event);
+        //names and budgets given before the type is profiled wait in mDelegateSettings
+        struct DelegateSetting {
+            EventDelegate delegate;
+            std::string name;
+            float budget{0.f};
+        };
+        
+        void setDelegateName(type_id_t type, const EventDelegate& delegate, std::string name);
+        void setDelegateBudget(type_id_t type, const EventDelegate& delegate, float milliseconds);
+        DelegateSetting& getDelegateSetting(type_id_t type, const EventDelegate& delegate);
+        DelegateProfiler& getProfiler(type_id_t type);
+        
+        EventStatus multicast(EventDelegateList& list, const IEventRef& event);
+        EventStatus multicast(EventDelegateList& list, const IEventRef& event, DelegateProfiler* profiler);
         
         void deferEvent(const IEventRef& event);
         
@@ -101,6 +179,8 @@ namespace mediasystem {
         TimedLockingQueue<IEventRef,1024> mThreadedQueue;
         std::vector<IEventRef> mDeferedEvents;
         std::map<type_id_t, EventDelegateList> mEvents;
+        std::map<type_id_t, std::unique_ptr<DelegateProfiler>> mProfilers;
+        std::map<type_id_t, std::vector<DelegateSetting>> mDelegateSettings;
     };
     
 }//end namespace mediasystem
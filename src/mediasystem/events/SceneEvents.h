@@ -8,9 +8,13 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <memory>
+#include <cmath>
+#include <algorithm>
 #include "mediasystem/events/IEvent.h"
 #include "mediasystem/util/TypeID.hpp"
-#include "mediasystem/core/Handle.h"
+#include "mediasystem/core/HandleConfig.h"
 
 namespace mediasystem {
     
@@ -27,7 +31,8 @@ namespace mediasystem {
         Handle<Entity> mEntity;
     };
     
-    //sent each time a scene destroys an existing entity
+    //sent for each destroyed entity, only while something listens for it. DestroyEntities covers
+    //every destroyed entity and is much cheaper for large batches.
     class DestroyEntity : public Event<DestroyEntity> {
     public:
         DestroyEntity(Handle<Entity>&& entity):mEntity(std::move(entity)){}
@@ -41,13 +46,28 @@ namespace mediasystem {
     template<typename ComponentType>
     class NewComponent : public Event<NewComponent<ComponentType>> {
     public:
-        NewComponent(Handle<Entity> entity, Handle<ComponentType> comp):mEntity(std::move(entity)),mComponent(std::move(comp)){}
+        NewComponent(Handle<Entity> entity, ComponentHandle<ComponentType> comp):mEntity(std::move(entity)),mComponent(std::move(comp)){}
         inline type_id_t getComponentType(){ return type_id<ComponentType>; }
-        Handle<ComponentType> getComponentHandle(){ return mComponent; }
+        ComponentHandle<ComponentType> getComponentHandle(){ return mComponent; }
         Handle<Entity> getEntityHandle(){ return mEntity; }
     private:
         Handle<Entity> mEntity;
-        Handle<ComponentType> mComponent;
+        ComponentHandle<ComponentType> mComponent;
+    };
+    
+    //sent once per component type by Scene::createEntities in place of a NewComponent per entity,
+    //handles are parallel to the entity ids
+    template<typename ComponentType>
+    class NewComponents : public Event<NewComponents<ComponentType>> {
+    public:
+        NewComponents(std::shared_ptr<const std::vector<size_t>> ids, std::vector<ComponentHandle<ComponentType>>&& comps):mEntityIds(std::move(ids)),mComponents(std::move(comps)){}
+        inline type_id_t getComponentType(){ return type_id<ComponentType>; }
+        inline size_t size() const { return mComponents.size(); }
+        inline const std::vector<size_t>& getEntityIds() const { return *mEntityIds; }
+        inline const std::vector<ComponentHandle<ComponentType>>& getComponentHandles() const { return mComponents; }
+    private:
+        std::shared_ptr<const std::vector<size_t>> mEntityIds;
+        std::vector<ComponentHandle<ComponentType>> mComponents;
     };
     
     template<typename Self>
@@ -59,6 +79,26 @@ namespace mediasystem {
     private:
         Scene& mScene;
     };
+    
+    //sent once per Scene::createEntities call in place of a NewEntity per entity
+    class NewEntities : public SceneEvent<NewEntities> {
+    public:
+        NewEntities(Scene& scene, std::shared_ptr<const std::vector<size_t>> ids):SceneEvent<NewEntities>(scene),mEntityIds(std::move(ids)){}
+        inline size_t size() const { return mEntityIds->size(); }
+        inline const std::vector<size_t>& getEntityIds() const { return *mEntityIds; }
+    private:
+        std::shared_ptr<const std::vector<size_t>> mEntityIds;
+    };
+
+    //sent once per batch of destroyed entities, before any of their components are destroyed
+    class DestroyEntities : public SceneEvent<DestroyEntities> {
+    public:
+        DestroyEntities(Scene& scene, std::shared_ptr<const std::vector<size_t>> ids):SceneEvent<DestroyEntities>(scene),mEntityIds(std::move(ids)){}
+        inline size_t size() const { return mEntityIds->size(); }
+        inline const std::vector<size_t>& getEntityIds() const { return *mEntityIds; }
+    private:
+        std::shared_ptr<const std::vector<size_t>> mEntityIds;
+    };
 
     //will cause the current scene to transition out and the scene designated in the message to
     //transition in
@@ -88,6 +128,18 @@ namespace mediasystem {
         PostInit(Scene& scene):SceneEvent<PostInit>(scene){}
     };
     
+    //sent once the last load step queued with Scene::addLoadStep has finished
+    class LoadComplete : public SceneEvent<LoadComplete> {
+    public:
+        LoadComplete(Scene& scene, size_t steps, float seconds):SceneEvent<LoadComplete>(scene),mSteps(steps),mSeconds(seconds){}
+        inline size_t getNumSteps() const { return mSteps; }
+        //wall time from the first step to the last, across every frame it was spread over
+        inline float getDuration() const { return mSeconds; }
+    private:
+        size_t mSteps;
+        float mSeconds;
+    };
+    
     class Shutdown : public SceneEvent<Shutdown> {
     public:
         Shutdown(Scene& scene):SceneEvent<Shutdown>(scene){}
@@ -121,6 +173,47 @@ namespace mediasystem {
         double mLastFrameTime;
     };
     
+    //How often a delegate added with Scene::addUpdateDelegate runs. Delegates in the same tier are
+    //spread across it unless they are given a phase, so their work doesn't land on the same frame.
+    struct UpdateRate {
+        enum Type { EVERY_FRAME, EVERY_NTH_FRAME, FIXED_HZ };
+        
+        static UpdateRate everyFrame(){ return UpdateRate(); }
+        //phase is in frames, the delegate runs on the frames where frame % n == phase
+        static UpdateRate everyNthFrame(size_t n){
+            UpdateRate rate;
+            rate.type = n > 1 ? EVERY_NTH_FRAME : EVERY_FRAME;
+            rate.frames = std::max<size_t>(n, 1);
+            return rate;
+        }
+        static UpdateRate everyNthFrame(size_t n, size_t phase){
+            auto rate = everyNthFrame(n);
+            rate.framePhase = phase % rate.frames;
+            rate.staggered = false;
+            return rate;
+        }
+        //phase is in seconds, the delegate first runs once the scene's elapsed time is past it
+        static UpdateRate fixedHz(float hz){
+            UpdateRate rate;
+            rate.type = hz > 0.f ? FIXED_HZ : EVERY_FRAME;
+            rate.period = hz > 0.f ? 1.f / hz : 0.f;
+            return rate;
+        }
+        static UpdateRate fixedHz(float hz, float phase){
+            auto rate = fixedHz(hz);
+            rate.timePhase = rate.period > 0.f ? std::fmod(std::max(phase, 0.f), rate.period) : 0.f;
+            rate.staggered = false;
+            return rate;
+        }
+        
+        Type type{EVERY_FRAME};
+        size_t frames{1};
+        size_t framePhase{0};
+        float period{0.f}; //seconds
+        float timePhase{0.f};
+        bool staggered{true}; //the scene picks the phase
+    };
+    
     //draws all subscribers
     class Draw : public SceneEvent<Draw> {
     public:
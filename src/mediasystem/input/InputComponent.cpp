@@ -17,18 +17,34 @@ namespace mediasystem {
         mSize(screenBounds.width, screenBounds.height),
         mHandlers(std::move(handlers))
     {
-        mNode = context.getComponent<ofNode>();
+        mNode = context.getComponentHandle<ofNode>();
+    }
+    
+    InputComponent::InputComponent( Entity& context, const InputComponent& other ) :
+        mContext(context),
+        mZIndex(other.mZIndex),
+        mEnabled(other.mEnabled),
+        mScreenBounds(other.mScreenBounds),
+        mSize(other.mSize),
+        mHandlers(other.mHandlers)
+    {
+        mNode = context.getComponentHandle<ofNode>();
     }
     
     void InputComponent::update()
     {
         if(auto node = mNode.lock()){
-            auto pos = node->getGlobalPosition();
-            auto scale = node->getGlobalScale();
-            mScreenBounds = ofRectangle( pos.x, pos.y, mSize.x * scale.x, mSize.y * scale.y );
+            update(*node);
         }
     }
     
+    void InputComponent::update(const ofNode& node)
+    {
+        auto pos = node.getGlobalPosition();
+        auto scale = node.getGlobalScale();
+        mScreenBounds = ofRectangle( pos.x, pos.y, mSize.x * scale.x, mSize.y * scale.y );
+    }
+    
     void InputComponent::setEnabled(bool enable)
     {
         mEnabled = enable;
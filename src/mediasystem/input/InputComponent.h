@@ -8,6 +8,7 @@
 #pragma once
 #include <memory>
 #include "mediasystem/events/IEvent.h"
+#include "mediasystem/core/ComponentStorage.h"
 #include "ofMain.h"
 
 namespace mediasystem {
@@ -58,9 +59,12 @@ namespace mediasystem {
     public:
         
         InputComponent( Entity& context, const ofRectangle& screenBounds, int z_index = 0, InputHandlers handlers = InputHandlers() );
+        //copies other onto a different entity, used by Scene::createEntities and Prefab
+        InputComponent( Entity& context, const InputComponent& other );
         ~InputComponent() = default;
         
         void update();
+        void update(const ofNode& node);
         
         bool check(const glm::vec2& point)const;
         bool isEnabled()const;
@@ -95,7 +99,7 @@ namespace mediasystem {
     private:
         
         Entity& mContext;
-        std::weak_ptr<ofNode> mNode;
+        ComponentHandle<ofNode> mNode;
         bool mHovering{false};
         bool mPressed{false};
         int mZIndex{0};
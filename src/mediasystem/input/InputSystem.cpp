@@ -15,13 +15,18 @@
 
 namespace mediasystem {
     
-    InputSystem::InputSystem(Scene& context):
-        mContext(context)
+    InputSystem::InputSystem(Scene& context, SystemAccess access):
+        mContext(context),
+        mComponents(context.getComponents<InputComponent>())
     {
-        context.addDelegate<Update>(EventDelegate::create<InputSystem, &InputSystem::onUpdateEvent>(this));
+        //handlers run on the main thread and usually move their entity around
+        access.write<InputComponent, ofNode>().onMainThread();
+        context.getScheduler().add("InputSystem", std::move(access), EventDelegate::create<InputSystem, &InputSystem::onUpdateEvent>(this));
         context.addDelegate<Start>(EventDelegate::create<InputSystem, &InputSystem::onStartEvent>(this));
         context.addDelegate<Stop>(EventDelegate::create<InputSystem, &InputSystem::onStopEvent>(this));
-        context.addDelegate<NewComponent<InputComponent>>(EventDelegate::create<InputSystem, &InputSystem::onNewInputComponent>(this));
+        //batched, components created or destroyed by input handlers must not change the lists while update walks them
+        context.onConstruct<InputComponent>(ComponentBatchObserver::create<InputSystem, &InputSystem::onInputComponentsConstructed>(this));
+        context.onDestroy<InputComponent>(ComponentBatchObserver::create<InputSystem, &InputSystem::onInputComponentsDestroyed>(this));
         
         context.addDelegate<Shutdown>(EventDelegate::create<InputSystem, &InputSystem::onResetEvent>(this));
         addGlobalEventDelegate<SystemReset>(EventDelegate::create<InputSystem, &InputSystem::onResetEvent>(this));
@@ -29,35 +34,45 @@ namespace mediasystem {
     
     InputSystem::~InputSystem()
     {
-        mContext.removeDelegate<Update>(EventDelegate::create<InputSystem, &InputSystem::onUpdateEvent>(this));
+        mContext.getScheduler().remove(EventDelegate::create<InputSystem, &InputSystem::onUpdateEvent>(this));
         mContext.removeDelegate<Start>(EventDelegate::create<InputSystem, &InputSystem::onStartEvent>(this));
         mContext.removeDelegate<Stop>(EventDelegate::create<InputSystem, &InputSystem::onStopEvent>(this));
-        mContext.removeDelegate<NewComponent<InputComponent>>(EventDelegate::create<InputSystem, &InputSystem::onNewInputComponent>(this));
+        mContext.removeOnConstruct<InputComponent>(ComponentBatchObserver::create<InputSystem, &InputSystem::onInputComponentsConstructed>(this));
+        mContext.removeOnDestroy<InputComponent>(ComponentBatchObserver::create<InputSystem, &InputSystem::onInputComponentsDestroyed>(this));
         
         mContext.removeDelegate<Shutdown>(EventDelegate::create<InputSystem, &InputSystem::onResetEvent>(this));
         removeGlobalEventDelegate<SystemReset>(EventDelegate::create<InputSystem, &InputSystem::onResetEvent>(this));
     }
     
-    EventStatus InputSystem::onNewInputComponent(const IEventRef& event)
+    void InputSystem::onInputComponentsConstructed(const std::vector<size_t>& entity_ids)
     {
-        auto cast = std::static_pointer_cast<NewComponent<InputComponent>>(event);
-        if(cast->getComponentType() == &type_id<InputComponent>){
-            auto compHandle = cast->getComponentHandle();
-            if(auto comp = compHandle.lock()){
+        for(auto entity_id : entity_ids){
+            if(mLocations.count(entity_id))
+                continue;
+            if(auto comp = mComponents.get(entity_id)){
                 auto z_index = comp->getZIndex();
-                auto found = mComponentsByZIndex.find(z_index);
-                if(found != mComponentsByZIndex.end()){
-                    found->second.emplace_back(compHandle);
-                }else{
-                    auto l = std::list<InputComponentHandle>();
-                    l.emplace_back(compHandle);
-                    mComponentsByZIndex.emplace(z_index,std::move(l));
-                }
+                auto& list = mComponentsByZIndex[z_index];
+                list.emplace_back(entity_id);
+                mLocations[entity_id] = Location{z_index, std::prev(list.end())};
             }
-            return EventStatus::SUCCESS;
         }
-        MS_LOG_ERROR("Something is wrong, the type_ids should match for in inputsystem on new component!");
-        return EventStatus::FAILED;
+    }
+    
+    void InputSystem::onInputComponentsDestroyed(const std::vector<size_t>& entity_ids)
+    {
+        for(auto entity_id : entity_ids){
+            //destroyed and created again in the same frame
+            if(mComponents.get(entity_id))
+                continue;
+            auto found = mLocations.find(entity_id);
+            if(found == mLocations.end())
+                continue;
+            auto layer = mComponentsByZIndex.find(found->second.z_index);
+            layer->second.erase(found->second.it);
+            if(layer->second.empty())
+                mComponentsByZIndex.erase(layer);
+            mLocations.erase(found);
+        }
     }
    
     EventStatus InputSystem::onStartEvent(const IEventRef& event)
@@ -112,55 +127,41 @@ namespace mediasystem {
         mConnected = false;
     }
     
+    template<typename Handler>
+    bool InputSystem::dispatch(Handler handler)
+    {
+        for(auto & layer : mComponentsByZIndex){
+            for(auto entity_id : layer.second){
+                //null only if it was destroyed earlier in this update, it's dropped at the next flush.
+                //Locked so a handler can remove its own component, with generational handles it has to
+                //defer that through a CommandBuffer.
+                auto comp = mComponents.getStrongHandle(entity_id);
+                if(comp && handler(*comp))
+                    return true;
+            }
+        }
+        return false;
+    }
+    
     void InputSystem::update()
     {
         if(!mKeyEvents.empty()){
             for(auto & event : mKeyEvents){
                 switch (event.first) {
                     case KEY_PRESSED:
-                    {
-                        auto layerIt = mComponentsByZIndex.begin();
-                        auto layerEnd = mComponentsByZIndex.end();
-                        while(layerIt != layerEnd){
-                            auto compIt = layerIt->second.begin();
-                            auto compEnd = layerIt->second.end();
-                            while(compIt!=compEnd){
-                                if(auto comp = compIt->lock()){
-                                    if(comp->isEnabled())
-                                        comp->keyPressed(event.second);
-                                    ++compIt;
-                                }else{
-                                    compIt = layerIt->second.erase(compIt);
-                                }
-                            }
-                            if(layerIt->second.empty())
-                                layerIt = mComponentsByZIndex.erase(layerIt);
-                            else
-                                ++layerIt;
-                        }
-                    }break;
+                        dispatch([&](InputComponent& comp){
+                            if(comp.isEnabled())
+                                comp.keyPressed(event.second);
+                            return false;
+                        });
+                        break;
                     case KEY_RELEASED:
-                    {
-                        auto layerIt = mComponentsByZIndex.begin();
-                        auto layerEnd = mComponentsByZIndex.end();
-                        while(layerIt != layerEnd){
-                            auto compIt = layerIt->second.begin();
-                            auto compEnd = layerIt->second.end();
-                            while(compIt!=compEnd){
-                                if(auto comp = compIt->lock()){
-                                    if(comp->isEnabled())
-                                        comp->keyReleased(event.second);
-                                    ++compIt;
-                                }else{
-                                    compIt = layerIt->second.erase(compIt);
-                                }
-                            }
-                            if(layerIt->second.empty())
-                                layerIt = mComponentsByZIndex.erase(layerIt);
-                            else
-                                ++layerIt;
-                        }
-                    }break;
+                        dispatch([&](InputComponent& comp){
+                            if(comp.isEnabled())
+                                comp.keyReleased(event.second);
+                            return false;
+                        });
+                        break;
                     default:
                         break;
                 }
@@ -170,189 +171,26 @@ namespace mediasystem {
         
         if(!mMouseEvents.empty()){
             for(auto & event : mMouseEvents){
-                bool handled = false;
+                //the first component to handle a mouse event stops it
                 switch (event.first) {
                     case MOUSE_MOVE:
-                    {
-                        auto layerIt = mComponentsByZIndex.begin();
-                        auto layerEnd = mComponentsByZIndex.end();
-                        while(layerIt != layerEnd){
-                            if(handled){
-                                break;
-                            }
-                            auto compIt = layerIt->second.begin();
-                            auto compEnd = layerIt->second.end();
-                            while(compIt!=compEnd){
-                                if(handled){
-                                    break;
-                                }
-                                if(auto comp = compIt->lock()){
-                                    if(comp->mouseMove(event.second))
-                                    {
-                                        handled = true;
-                                    }
-                                    ++compIt;
-                                }else{
-                                    compIt = layerIt->second.erase(compIt);
-                                }
-                            }
-                            if(layerIt->second.empty())
-                                layerIt = mComponentsByZIndex.erase(layerIt);
-                            else
-                                ++layerIt;
-                        }
-                    }break;
+                        dispatch([&](InputComponent& comp){ return comp.mouseMove(event.second); });
+                        break;
                     case MOUSE_EXIT:
-                    {
-                        auto layerIt = mComponentsByZIndex.begin();
-                        auto layerEnd = mComponentsByZIndex.end();
-                        while(layerIt != layerEnd){
-                            if(handled){
-                                break;
-                            }
-                            auto compIt = layerIt->second.begin();
-                            auto compEnd = layerIt->second.end();
-                            while(compIt!=compEnd){
-                                if(handled){
-                                    break;
-                                }
-                                if(auto comp = compIt->lock()){
-                                    if(comp->mouseExit(event.second))
-                                    {
-                                        handled = true;
-                                    }
-                                    ++compIt;
-                                }else{
-                                    compIt = layerIt->second.erase(compIt);
-                                }
-                            }
-                            if(layerIt->second.empty())
-                                layerIt = mComponentsByZIndex.erase(layerIt);
-                            else
-                                ++layerIt;
-                        }
-                    }break;
+                        dispatch([&](InputComponent& comp){ return comp.mouseExit(event.second); });
+                        break;
                     case MOUSE_DRAGGED:
-                    {
-                        auto layerIt = mComponentsByZIndex.begin();
-                        auto layerEnd = mComponentsByZIndex.end();
-                        while(layerIt != layerEnd){
-                            if(handled){
-                                break;
-                            }
-                            auto compIt = layerIt->second.begin();
-                            auto compEnd = layerIt->second.end();
-                            while(compIt!=compEnd){
-                                if(handled){
-                                    break;
-                                }
-                                if(auto comp = compIt->lock()){
-                                    if(comp->mouseDragged(event.second))
-                                    {
-                                        handled = true;
-                                    }
-                                    ++compIt;
-                                }else{
-                                    compIt = layerIt->second.erase(compIt);
-                                }
-                            }
-                            if(layerIt->second.empty())
-                                layerIt = mComponentsByZIndex.erase(layerIt);
-                            else
-                                ++layerIt;
-                        }
-                    }break;
+                        dispatch([&](InputComponent& comp){ return comp.mouseDragged(event.second); });
+                        break;
                     case MOUSE_PRESSED:
-                    {
-                        auto layerIt = mComponentsByZIndex.begin();
-                        auto layerEnd = mComponentsByZIndex.end();
-                        while(layerIt != layerEnd){
-                            if(handled){
-                                break;
-                            }
-                            auto compIt = layerIt->second.begin();
-                            auto compEnd = layerIt->second.end();
-                            while(compIt!=compEnd){
-                                if(handled){
-                                    break;
-                                }
-                                if(auto comp = compIt->lock()){
-                                    if(comp->mousePressed(event.second))
-                                    {
-                                        handled = true;
-                                    }
-                                    ++compIt;
-                                }else{
-                                    compIt = layerIt->second.erase(compIt);
-                                }
-                            }
-                            if(layerIt->second.empty())
-                                layerIt = mComponentsByZIndex.erase(layerIt);
-                            else
-                                ++layerIt;
-                        }
-                    }break;
+                        dispatch([&](InputComponent& comp){ return comp.mousePressed(event.second); });
+                        break;
                     case MOUSE_SCROLL:
-                    {
-                        auto layerIt = mComponentsByZIndex.begin();
-                        auto layerEnd = mComponentsByZIndex.end();
-                        while(layerIt != layerEnd){
-                            if(handled){
-                                break;
-                            }
-                            auto compIt = layerIt->second.begin();
-                            auto compEnd = layerIt->second.end();
-                            while(compIt!=compEnd){
-                                if(handled){
-                                    break;
-                                }
-                                if(auto comp = compIt->lock()){
-                                    if(comp->mouseScrollWheel(event.second))
-                                    {
-                                        handled = true;
-                                    }
-                                    ++compIt;
-                                }else{
-                                    compIt = layerIt->second.erase(compIt);
-                                }
-                            }
-                            if(layerIt->second.empty())
-                                layerIt = mComponentsByZIndex.erase(layerIt);
-                            else
-                                ++layerIt;
-                        }
-                    }break;
+                        dispatch([&](InputComponent& comp){ return comp.mouseScrollWheel(event.second); });
+                        break;
                     case MOUSE_RELEASED:
-                    {
-                        auto layerIt = mComponentsByZIndex.begin();
-                        auto layerEnd = mComponentsByZIndex.end();
-                        while(layerIt != layerEnd){
-                            if(handled){
-                                break;
-                            }
-                            auto compIt = layerIt->second.begin();
-                            auto compEnd = layerIt->second.end();
-                            while(compIt!=compEnd){
-                                if(handled){
-                                    break;
-                                }
-                                if(auto comp = compIt->lock()){
-                                    if(comp->mouseReleased(event.second))
-                                    {
-                                        handled = true;
-                                    }
-                                    ++compIt;
-                                }else{
-                                    compIt = layerIt->second.erase(compIt);
-                                }
-                            }
-                            if(layerIt->second.empty())
-                                layerIt = mComponentsByZIndex.erase(layerIt);
-                            else
-                                ++layerIt;
-                        }
-                    }break;
-                        
+                        dispatch([&](InputComponent& comp){ return comp.mouseReleased(event.second); });
+                        break;
                     default:
                         break;
                 }
@@ -361,29 +199,51 @@ namespace mediasystem {
             mMouseEvents.clear();
         }
         
-        //update components
-        {
-            auto indexIt = mComponentsByZIndex.begin();
-            auto indexEnd = mComponentsByZIndex.end();
-            while(indexIt != indexEnd){
-                auto layerIt = indexIt->second.begin();
-                auto layerEnd = indexIt->second.end();
-                while(layerIt != layerEnd){
-                    if(auto comp = layerIt->lock()){
-                        comp->update();
-                        ++layerIt;
-                    }else{
-                        layerIt = indexIt->second.erase(layerIt);
-                    }
+        //update components, the lists only hold live ones, they're kept by the construct and destroy observers.
+        //Only new components and those whose node or an ancestor's moved since the last update need new screen
+        //areas, a moved node takes its whole subtree along.
+        auto frame = mContext.getFrame();
+        auto inputs = mContext.view<InputComponent, ofNode>();
+        if(mRefreshAll){
+            inputs.each([](size_t entity_id, InputComponent& input, ofNode& node){
+                input.update(node);
+            });
+        }else{
+            ++mRefreshPass;
+            auto graphs = mContext.getComponents<EntityGraph>();
+            mContext.eachChanged<ofNode>(mLastUpdateFrame, [&](size_t entity_id, ofNode&){
+                auto graph = graphs.get(entity_id);
+                if(!graph || graph->numChildren == 0){
+                    refresh(entity_id, inputs);
+                    return;
                 }
-                ++indexIt;
-            }
+                for(auto & descendant : graph->getSubtree()){
+                    refresh(descendant.self.getId(), inputs);
+                }
+            });
+            mContext.eachChanged<InputComponent>(mLastUpdateFrame, [&](size_t entity_id, InputComponent&){
+                refresh(entity_id, inputs);
+            });
         }
+        mLastUpdateFrame = frame;
+    }
+    
+    void InputSystem::refresh(size_t entity_id, ComponentView<InputComponent, ofNode>& inputs)
+    {
+        auto index = getEntityIndex(entity_id);
+        if(index >= mRefreshedIn.size())
+            mRefreshedIn.resize(index + 1, 0);
+        if(mRefreshedIn[index] == mRefreshPass)
+            return;
+        mRefreshedIn[index] = mRefreshPass;
+        if(inputs.contains(entity_id))
+            inputs.get<InputComponent>(entity_id).update(inputs.get<ofNode>(entity_id));
     }
     
     void InputSystem::reset()
     {
         mComponentsByZIndex.clear();
+        mLocations.clear();
         mMouseEvents.clear();
         mKeyEvents.clear();
     }
@@ -8,6 +8,9 @@
 #pragma once
 
 #include "mediasystem/events/EventManager.h"
+#include "mediasystem/core/ComponentStorage.h"
+#include "mediasystem/core/Scene.h"
+#include "mediasystem/core/SystemScheduler.h"
 #include "mediasystem/input/InputComponent.h"
 #include "mediasystem/input/ScreenBounds.hpp"
 
@@ -15,19 +18,28 @@ namespace mediasystem {
     
     class Scene;
     class InputComponent;
-    using InputComponentHandle = Handle<InputComponent>;
+    using InputComponentHandle = ComponentHandle<InputComponent>;
 
     class InputSystem {
     public:
         
-        InputSystem(Scene& context);
+        //Runs as a scheduled system writing InputComponent and ofNode. Handlers that touch other
+        //components have to declare them in access, or pass SystemAccess().exclusive().
+        InputSystem(Scene& context, SystemAccess access = SystemAccess());
         ~InputSystem();
         
         void connect();
         void disconnect();
 
+        //Screen areas follow the entity's ofNode only when it or one of its ancestors is marked changed,
+        //Entity's transform setters do that. A node edited directly, ie. getComponent<ofNode>()->setPosition()
+        //or through a view<ofNode>, isn't seen and its areas go stale: call Scene::markChanged<ofNode>
+        //after the edit, or turn on refreshAll to recompute every area each update like before.
         void update();
         void reset();
+        
+        inline void setRefreshAll(bool refreshAll){ mRefreshAll = refreshAll; }
+        inline bool isRefreshingAll() const { return mRefreshAll; }
 
     private:
         
@@ -35,7 +47,14 @@ namespace mediasystem {
         EventStatus onStopEvent(const IEventRef& event);
         EventStatus onUpdateEvent(const IEventRef& event);
         EventStatus onResetEvent(const IEventRef& event);
-        EventStatus onNewInputComponent(const IEventRef& event);
+        void onInputComponentsConstructed(const std::vector<size_t>& entity_ids);
+        void onInputComponentsDestroyed(const std::vector<size_t>& entity_ids);
+        //recomputes the entity's screen area once per update
+        void refresh(size_t entity_id, ComponentView<InputComponent, ofNode>& inputs);
+        //calls handler on every component until one returns true, returns whether one did. With shared
+        //handles a handler may remove its own InputComponent, the component lives until the call returns.
+        template<typename Handler>
+        bool dispatch(Handler handler);
 
         enum EventType { MOUSE_MOVE, MOUSE_EXIT, MOUSE_PRESSED, MOUSE_RELEASED, MOUSE_DRAGGED, MOUSE_SCROLL, KEY_PRESSED, KEY_RELEASED };
         
@@ -50,9 +69,20 @@ namespace mediasystem {
         
         Scene& mContext;
         bool mConnected{false};
+        uint64_t mLastUpdateFrame{0};
+        bool mRefreshAll{false};
+        //entity index -> the refresh pass that last recomputed it, a subtree can be reached more than once
+        std::vector<uint64_t> mRefreshedIn;
+        uint64_t mRefreshPass{0};
         std::deque<std::pair<EventType, ofKeyEventArgs>> mKeyEvents;
         std::deque<std::pair<EventType, ofMouseEventArgs>> mMouseEvents;
-        std::unordered_map<int, std::list<InputComponentHandle>> mComponentsByZIndex;
+        ComponentMap<InputComponent> mComponents;
+        std::unordered_map<int, std::list<size_t>> mComponentsByZIndex; //entity ids
+        struct Location {
+            int z_index;
+            std::list<size_t>::iterator it;
+        };
+        std::unordered_map<size_t, Location> mLocations;
         
     };
     
@@ -15,18 +15,19 @@ namespace mediasystem {
     class ScreenBounds {
     public:
         
-        ScreenBounds(Entity& context, ofRectangle rect):
+        //bounds of things that rarely move can be refreshed at a lower rate, ie. UpdateRate::everyNthFrame(4)
+        ScreenBounds(Entity& context, ofRectangle rect, const UpdateRate& rate = UpdateRate::everyFrame()):
             mContext(context),
             mCachedBounds(rect),
             mSize(rect.width, rect.height),
             mOrigin(rect.x, rect.y)
         {
-            mContext.getScene().addDelegate<Update>(EventDelegate::create<ScreenBounds,&ScreenBounds::onUpdate>(this));
+            mContext.getScene().addUpdateDelegate(EventDelegate::create<ScreenBounds,&ScreenBounds::onUpdate>(this), rate, "ScreenBounds");
         }
         
         ~ScreenBounds()
         {
-            mContext.getScene().removeDelegate<Update>(EventDelegate::create<ScreenBounds,&ScreenBounds::onUpdate>(this));
+            mContext.getScene().removeUpdateDelegate(EventDelegate::create<ScreenBounds,&ScreenBounds::onUpdate>(this));
         }
         
         void update(){
@@ -42,31 +43,61 @@ namespace mediasystem {
         inline bool isEnabled(){ return mEnabled; }
         inline void disable(){ mEnabled = false; }
         inline void enable(){ mEnabled = true; }
+        
+        //The bounds follow the node only when it or an ancestor is marked changed, Entity's transform
+        //setters do that. After editing an ofNode directly call Scene::markChanged<ofNode>, or turn on
+        //refreshAlways to recompute the bounds every time the update runs.
+        inline void setRefreshAlways(bool refreshAlways){ mRefreshAlways = refreshAlways; }
 
     private:
         
         EventStatus onUpdate(const IEventRef&){
-            update();
+            //only follow the node when it or an ancestor was marked changed since the last update
+            auto& scene = mContext.getScene();
+            if(mRefreshAlways || hasMoved(scene))
+                update();
+            mUpdatedFrame = scene.getFrame();
             return EventStatus::SUCCESS;
         }
         
+        bool hasMoved(Scene& scene){
+            auto graphs = scene.getComponents<EntityGraph>();
+            for(auto id = mContext.getId(); id != INVALID_ENTITY_ID;){
+                auto frame = scene.getChangeFrame<ofNode>(id);
+                if(frame != NO_CHANGE_FRAME && frame >= mUpdatedFrame)
+                    return true;
+                auto graph = graphs.get(id);
+                id = graph ? graph->parent : INVALID_ENTITY_ID;
+            }
+            return false;
+        }
+        
         Entity& mContext;
+        uint64_t mUpdatedFrame{0};
         bool mEnabled{true};
+        bool mRefreshAlways{false};
         ofRectangle mCachedBounds;
         glm::vec2 mSize;
         glm::vec2 mOrigin;
     };
     
+    //registers itself as an update delegate, so it has to stay put in archetype scenes
+    template<>
+    struct is_relocatable_component<ScreenBounds> : std::false_type {};
+    
     struct ScreenBoundsDebug {
-        ScreenBoundsDebug(std::shared_ptr<ScreenBounds> comp):input(comp){}
-        std::shared_ptr<ScreenBounds> input;
+        ScreenBoundsDebug(ComponentHandle<ScreenBounds> comp):input(std::move(comp)){}
+        ComponentHandle<ScreenBounds> input;
         void draw(){
+            auto bounds = input.lock();
+            if(!bounds)
+                return;
             ofPushStyle();
             ofNoFill();
             auto matrix = glm::inverse(ofGetCurrentViewMatrix()) * ofGetCurrentMatrix(ofMatrixMode::OF_MATRIX_MODELVIEW);
             ofMultMatrix(glm::inverse(matrix));
             ofSetColor(255,255,0);
-            ofDrawRectangle(input->getScreenBounds());
+            ofDrawRectangle(bounds->getScreenBounds());
             ofMultMatrix(matrix);
             ofPopStyle();
         }
@@ -14,26 +14,25 @@ namespace mediasystem {
     {
         mVideoPlayers = mScene.getComponents<ofVideoPlayer>();
         mImageSequences = mScene.getComponents<ImageSequence>();
-        mScene.addDelegate<Update>(EventDelegate::create<MediaUpdateSystem, &MediaUpdateSystem::onUpdate>(this));
+        //players upload textures, so they stay on the main thread
+        mScene.getScheduler().add("MediaUpdateSystem", SystemAccess().write<ofVideoPlayer, ImageSequence>().onMainThread(), EventDelegate::create<MediaUpdateSystem, &MediaUpdateSystem::onUpdate>(this));
     }
     
     MediaUpdateSystem::~MediaUpdateSystem()
     {
-        mScene.removeDelegate<Update>(EventDelegate::create<MediaUpdateSystem, &MediaUpdateSystem::onUpdate>(this));
+        mScene.getScheduler().remove(EventDelegate::create<MediaUpdateSystem, &MediaUpdateSystem::onUpdate>(this));
     }
     
     EventStatus MediaUpdateSystem::onUpdate(const IEventRef& event)
     {
         auto update = std::static_pointer_cast<Update>(event);
         
-        auto it = mVideoPlayers.iter();
-        while (auto video = it.next()) {
-            video->update();
+        for (auto & video : mVideoPlayers) {
+            video.update();
         }
         
-        auto seqit = mImageSequences.iter();
-        while (auto seq = seqit.next()) {
-            seq->update(update->getLastFrameTime());
+        for (auto & seq : mImageSequences) {
+            seq.update(update->getLastFrameTime());
         }
         
         return EventStatus::SUCCESS;
@@ -7,6 +7,10 @@
 
 #pragma once
 
+#include <map>
+#include <vector>
+#include <typeinfo>
+#include <algorithm>
 #include "AllocationStrategies.hpp"
 #include "Storage.hpp"
 #include "AllocationMiddleware.hpp"
@@ -37,6 +41,7 @@ namespace mediasystem {
                 found->second = std::move(policy);
             }else{
                 mAllocaitonPolicies.emplace(type_id<T>, std::move(policy));
+                mTypeNames.emplace(type_id<T>, typeid(T).name());
             }
             return ret;
         }
@@ -50,8 +55,82 @@ namespace mediasystem {
             return setPolicy<T>(fmt);
         }
         
+        //Gives T, an allocator rebound from U like a shared_ptr control block or a container node, its
+        //policy. T gets U's format sized for the same number of objects, a pool is allocated and written
+        //right away since the first rebind happens as U's objects start being made, or both default to
+        //the heap. T is remembered so reservePool<U> can size it too.
+        template<typename T, typename U>
+        IAllocationPolicy* rebindPolicy(){
+            if(auto policy = getPolicy<T>())
+                return policy;
+            IAllocationPolicy* ret = nullptr;
+            if(auto policy = getPolicy<U>()){
+                ret = setPolicy<T>(scaleFormat(policy->getFormat(), sizeof(U), sizeof(T)));
+                if(ret->getStrategyType() != DEFAULT_HEAP)
+                    ret->initialize();
+            }else{
+                ret = setPolicy<T>();
+                setPolicy<U>();
+            }
+            mRebinds[type_id<U>].push_back(Rebind{type_id<T>, sizeof(T), &AllocationManager::createAllocationPolicy<T>});
+            return ret;
+        }
+        
+        //Pools count objects of T, and of every type already rebound from T, in one block each. The rebound
+        //pools are allocated and written straight away so their pages are resident, T's own pool is left to
+        //be created on its first allocate. A policy that still has live objects can't be swapped and is kept,
+        //returns false if any was.
+        template<typename T>
+        bool reservePool(size_t count){
+            auto fmt = AllocationPolicyFormat().unreclaimedPoolStrategy().blockListStorage(std::max<size_t>(count, 1) * poolObjectSize(sizeof(T)));
+            bool ret = true;
+            auto policy = getPolicy<T>();
+            if(!policy || policy->getStats().liveObjects == 0)
+                setPolicy<T>(fmt);
+            else
+                ret = false;
+            
+            auto rebinds = mRebinds.find(type_id<T>);
+            if(rebinds == mRebinds.end())
+                return ret;
+            for(auto & rebind : rebinds->second){
+                auto & rebound = mAllocaitonPolicies.at(rebind.type);
+                if(rebound->getStats().liveObjects > 0){
+                    ret = false;
+                    continue;
+                }
+                rebound = (this->*rebind.create)(scaleFormat(fmt, sizeof(T), rebind.objectSize));
+                rebound->initialize();
+            }
+            return ret;
+        }
+        
+        //calls fn(type_name, policy) for every type that has a policy, names are compiler specific
+        template<typename Fn>
+        void eachPolicy(Fn&& fn) const {
+            for(auto & policy : mAllocaitonPolicies){
+                fn(mTypeNames.at(policy.first), *policy.second);
+            }
+        }
+        
+        inline size_t getNumPolicies() const { return mAllocaitonPolicies.size(); }
+        
     private:
         
+        //pools round objects up to a multiple of the pointer size
+        static size_t poolObjectSize(size_t size){
+            return ((size + sizeof(void *)-1) / sizeof(void *)) * sizeof(void *);
+        }
+        
+        //fmt with its storage resized from objects of from_size to the same number of objects of to_size
+        static AllocationPolicyFormat scaleFormat(AllocationPolicyFormat fmt, size_t from_size, size_t to_size){
+            if(fmt.storage == NO_STORAGE)
+                return fmt;
+            auto count = std::max<size_t>(fmt.requestedStorageSize / poolObjectSize(from_size), 1);
+            fmt.storageSize = fmt.requestedStorageSize = count * poolObjectSize(to_size);
+            return fmt;
+        }
+        
         template<typename T>
         std::unique_ptr<IAllocationPolicy> createAllocationPolicy( const AllocationPolicyFormat& fmt) {
             std::unique_ptr<IAllocationPolicy> policy;
@@ -89,6 +168,14 @@ namespace mediasystem {
         }
         
         std::map<type_id_t, std::unique_ptr<IAllocationPolicy>> mAllocaitonPolicies;
+        std::map<type_id_t, const char*> mTypeNames;
+        
+        struct Rebind {
+            type_id_t type;
+            size_t objectSize;
+            std::unique_ptr<IAllocationPolicy> (AllocationManager::*create)(const AllocationPolicyFormat&);
+        };
+        std::map<type_id_t, std::vector<Rebind>> mRebinds;
         //todo, could include initializers if they worked...
     };
     
@@ -9,6 +9,7 @@
 
 #include <stdint.h>
 #include <cstddef>
+#include <algorithm>
 #include <iostream>
 #include "Storage.hpp"
 #include "AllocationStrategies.hpp"
@@ -47,8 +48,33 @@ namespace mediasystem {
         
     };
     
+    //Running totals kept by every policy. Counts are in objects of the policy's type, a single
+    //allocate(n) counts once as an allocation and n times towards the live objects.
+    struct AllocationStats {
+        size_t allocations{0};
+        size_t deallocations{0};
+        size_t liveObjects{0};
+        size_t peakObjects{0};
+        size_t objectSize{0};
+        size_t bytesReserved{0}; //pool blocks held, or the live bytes for heap policies
+        
+        inline size_t getLiveBytes() const { return liveObjects * objectSize; }
+        
+        void recordAllocation(size_t count){
+            ++allocations;
+            liveObjects += count;
+            peakObjects = std::max(peakObjects, liveObjects);
+        }
+        
+        void recordDeallocation(size_t count){
+            ++deallocations;
+            liveObjects -= std::min(liveObjects, count);
+        }
+    };
+    
     class IAllocationPolicy {
     public:
+        virtual ~IAllocationPolicy() = default;
         virtual void initialize() = 0;
         virtual void* allocate(size_t count) = 0;
         virtual void deallocate(void* ptr, size_t count) = 0;
@@ -59,6 +85,7 @@ namespace mediasystem {
         virtual size_t getStorageCount() const = 0;
         virtual size_t getStorageInitialCount() const = 0;
         virtual AllocationPolicyFormat getFormat() const = 0;
+        virtual AllocationStats getStats() const = 0;
         virtual std::vector<AllocationMiddlewareType> getMiddlewareTypes() const = 0;
         virtual void addMiddleware( std::unique_ptr<IAllocaitonMiddleware>&& middleware ) = 0;
     };
@@ -83,6 +110,7 @@ namespace mediasystem {
             if(!mInitialized)
                 initialize();
             auto ret = mStrategy.allocate( count, mStorage );
+            mStats.recordAllocation(count);
 #if defined(MS_ALLOW_ALLOCATION_MIDDLEWARE)
             for(auto & middleware : mMiddlewares){
                 if(middleware)
@@ -95,6 +123,7 @@ namespace mediasystem {
         void deallocate(void* ptr, size_t count) override
         {
             mStrategy.deallocate( ptr, count, mStorage );
+            mStats.recordDeallocation(count);
 #if defined(MS_ALLOW_ALLOCATION_MIDDLEWARE)
             for(auto & middleware : mMiddlewares){
                 if(middleware)
@@ -113,6 +142,12 @@ namespace mediasystem {
         size_t getStorageSize() const override { return mStorage.getStorageSize(); }
         size_t getStorageCount() const override { return mStorage.getStorageCount(); }
         size_t getStorageInitialCount() const override { return mStorage.getStorageInitialCount(); }
+        AllocationStats getStats() const override {
+            auto stats = mStats;
+            stats.objectSize = mStorage.objectSize();
+            stats.bytesReserved = mInitialized ? mStorage.getStorageCount() * mStorage.getStorageSize() : 0;
+            return stats;
+        }
         std::vector<AllocationMiddlewareType> getMiddlewareTypes() const override {
             std::vector<AllocationMiddlewareType> ret;
             for(auto & middleware: mMiddlewares){
@@ -148,6 +183,7 @@ namespace mediasystem {
     private:
         std::array<std::unique_ptr<IAllocaitonMiddleware>,AllocationMiddlewareType::NO_MIDDLEWARE> mMiddlewares;
         bool mInitialized{false};
+        AllocationStats mStats;
         Storage mStorage;
         Strategy mStrategy;
     };
@@ -161,6 +197,8 @@ namespace mediasystem {
         void* allocate(size_t count) override
         {
             auto ret = ::operator new(count * sizeof(T), ::std::nothrow);
+            if(ret)
+                mStats.recordAllocation(count);
 #if defined(MS_ALLOW_ALLOCATION_MIDDLEWARE)
             for(auto & middleware : mMiddlewares){
                 if(middleware)
@@ -173,6 +211,7 @@ namespace mediasystem {
         void deallocate(void* ptr, size_t count) override
         {
             ::operator delete(ptr);
+            mStats.recordDeallocation(count);
 #if defined(MS_ALLOW_ALLOCATION_MIDDLEWARE)
             for(auto & middleware : mMiddlewares){
                 if(middleware)
@@ -191,6 +230,12 @@ namespace mediasystem {
         size_t getRequestedStorageSize() const override { return 0; }
         size_t getStorageCount() const override { return 0; }
         size_t getStorageInitialCount() const override { return 0; }
+        AllocationStats getStats() const override {
+            auto stats = mStats;
+            stats.objectSize = sizeof(T);
+            stats.bytesReserved = stats.getLiveBytes();
+            return stats;
+        }
         std::vector<AllocationMiddlewareType> getMiddlewareTypes() const override {
             std::vector<AllocationMiddlewareType> ret;
             for(auto & middleware: mMiddlewares){
@@ -219,6 +264,7 @@ namespace mediasystem {
         
     private:
         std::array<std::unique_ptr<IAllocaitonMiddleware>,AllocationMiddlewareType::NO_MIDDLEWARE> mMiddlewares;
+        AllocationStats mStats;
     };
     
     
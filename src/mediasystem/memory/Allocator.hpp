@@ -64,16 +64,14 @@ namespace mediasystem {
                     fmtStream << policy->getFormat();
                     ofLogVerbose("Memory") << "rebinding alloctor for type T [size: " << sizeof(T) <<" id: " << typeid(T).name() << "]\n"
                     << "from type U [size: " << sizeof(U) <<" id: " << typeid(U).name() << "]\n"
-                    << "with"
+                    << "with the same object count as"
                     << fmtStream.str();
-                    mManager->trySetPolicy<T>(policy->getFormat());
                 }else{
                     ofLogVerbose("Memory") << "don't have policies for U [id: " << typeid(U).name() << "]\n"
                     << "or T [id: " << typeid(T).name() << "]\n"
                     << "defaulting both to heap";
-                    mManager->setPolicy<T>(); //default
-                    mManager->setPolicy<U>(); //default
                 }
+                mManager->rebindPolicy<T, U>();
             }
             
         }
@@ -138,13 +138,12 @@ namespace mediasystem {
         }
         
         void draw(){
-            auto iter = mInstances.iter();
             if(mInstances.size() > mLocalBuffer.size()){
                 resize(mInstances.size());
             }
             auto dataPtr = mLocalBuffer.begin();
-            while(auto it = iter.next()){
-                callPopulate(*it, *dataPtr++, gen_seq<sizeof...(GPUTypes)>(), BoolType<(is_greater<sizeof...(GPUTypes),1>())>());
+            for(auto & instance : mInstances){
+                callPopulate(instance, *dataPtr++, gen_seq<sizeof...(GPUTypes)>(), BoolType<(is_greater<sizeof...(GPUTypes),1>())>());
             }
             mGpuBuffer.updateData(sizeof(GPURep) * mInstances.size(), mLocalBuffer.data());
             
@@ -8,8 +8,10 @@
 #pragma once
 
 #include <tuple>
+#include <unordered_map>
 #include "ofMain.h"
 #include "mediasystem/core/Entity.h"
+#include "mediasystem/core/TransformSystem.h"
 #include "mediasystem/rendering/IPresenter.h"
 #include "mediasystem/rendering/DefaultPresenter.h"
 #include "mediasystem/util/TupleHelpers.hpp"
@@ -31,6 +33,16 @@ public:
         mEntity(entity)
     {}
     
+    //copies other onto a different entity, used by Scene::createEntities
+    Drawable(Entity& entity, const Drawable& other):
+        T(other),
+        mEntity(entity),
+        mColor(other.mColor),
+        mDrawOrder(other.mDrawOrder),
+        mLayer(other.mLayer),
+        mVisible(other.mVisible)
+    {}
+    
     //setters
     void setLayer(std::string layer){ mLayer = std::move(layer); }
     void setDrawOrder(float order){ mDrawOrder = order; }
@@ -48,11 +60,12 @@ public:
     float getAlpha() const { return mColor.a; }
     float* getAlphaPtr() { return &mColor.a; }
     glm::mat4 getGlobalTransformMatrix(){
-        if(auto node = mEntity.getComponent<ofNode>()){
-            return node->getGlobalTransformMatrix();
+        if(mEntity.hasComponent<ofNode>()){
+            return mEntity.getGlobalTransformMatrix();
         }
         return glm::mat4();
     }
+    Entity& getEntity(){ return mEntity; }
     
     //drawable concept
     void draw(){
@@ -68,15 +81,23 @@ private:
 };
     
 template<typename T>
-using DrawableHandle = Handle<Drawable<T>>;
+using DrawableHandle = ComponentHandle<Drawable<T>>;
+
+//entities whose Drawable<T> sits at some draw order of a layer, typed so every T gets its own list
+template<typename T>
+struct DrawableId {
+    size_t entity_id;
+};
 
 template<typename T>
-using DrawableHandleList = std::list<DrawableHandle<T>,Allocator<DrawableHandle<T>>>;
+using DrawableList = std::list<DrawableId<T>,Allocator<DrawableId<T>>>;
 
+//Entries are added and dropped by batched construct and destroy observers, which the scene flushes
+//after its update, so drawing only visits live components and never erases.
 template<typename...DrawableTypes>
 class LayeredRenderer {
     
-    using TypesList = std::tuple<DrawableHandleList<DrawableTypes>...>;
+    using TypesList = std::tuple<DrawableList<DrawableTypes>...>;
     using OrderedLayer = std::map<float /* draw order */, TypesList>;
     struct Layer {
         Layer( std::string _name, std::shared_ptr<IPresenter> _presenter, float order = 0.f ):
@@ -90,20 +111,32 @@ class LayeredRenderer {
     };
     using LayerList = std::list<Layer>;
     
+    template<typename T>
+    struct Location {
+        OrderedLayer* layer;
+        float order;
+        typename DrawableList<T>::iterator it;
+    };
+    template<typename T>
+    using LocationMap = std::unordered_map<size_t, Location<T>>;
+    using Locations = std::tuple<LocationMap<DrawableTypes>...>;
+    using Components = std::tuple<ComponentMap<Drawable<DrawableTypes>>...>;
+    
 public:
     
     LayeredRenderer(Scene& scene):
-    mScene(scene)
+    mScene(scene),
+    mComponents(scene.getComponents<Drawable<DrawableTypes>>()...)
     {
         mLayers.emplace_back("default", std::make_shared<DefaultPresenter>(), std::numeric_limits<float>::max());
-        mScene.addDelegate<Draw>(EventDelegate::create<LayeredRenderer,&LayeredRenderer::onDraw>(this));
-        int l[] = {(addNewComponentDelegate<DrawableTypes>(),0)...};
+        mScene.addDelegate<Draw>(EventDelegate::create<LayeredRenderer,&LayeredRenderer::onDraw>(this), "LayeredRenderer");
+        int l[] = {(addObservers<DrawableTypes>(),0)...};
         UNUSED_VARIABLE(l);
     }
     
     ~LayeredRenderer(){
         mScene.removeDelegate<Draw>(EventDelegate::create<LayeredRenderer,&LayeredRenderer::onDraw>(this));
-        int l[] = {(removeNewComponentDelegate<DrawableTypes>(),0)...};
+        int l[] = {(removeObservers<DrawableTypes>(),0)...};
         UNUSED_VARIABLE(l);
     }
 
@@ -132,10 +165,11 @@ public:
                 for_each_in_tuple(order.second,OrderChecker<DrawableTypes...>(*this, layer.name, order.first));
             }
         }
+        auto nodes = mScene.view<ofNode>();
         for(auto & layer : mLayers){
             layer.presenter->begin();
             for ( auto & order : layer.layer ) {
-                for_each_in_tuple(order.second,LayerDrawer<DrawableTypes...>(*this));
+                for_each_in_tuple(order.second,LayerDrawer<DrawableTypes...>(*this, nodes));
             }
             layer.presenter->end();
         }
@@ -163,119 +197,142 @@ private:
     
     template<typename...Args>
     struct LayerDrawer {
-        LayerDrawer(LayeredRenderer<Args...>& renderer):mRenderer(renderer){}
+        LayerDrawer(LayeredRenderer<Args...>& renderer, ComponentView<ofNode>& nodes):mRenderer(renderer), mNodes(nodes){}
         template<typename T>
         void operator ()(T&& t){
-            mRenderer.drawLayer(t);
+            mRenderer.drawLayer(t, mNodes);
         }
         LayeredRenderer<Args...>& mRenderer;
+        ComponentView<ofNode>& mNodes;
     };
     
     template<typename T>
-    void addNewComponentDelegate(){
-        mScene.addDelegate<NewComponent<Drawable<T>>>(EventDelegate::create<LayeredRenderer, &LayeredRenderer::onNewLayeredComponent<T>>(this));
+    void addObservers(){
+        mScene.onConstruct<Drawable<T>>(ComponentBatchObserver::create<LayeredRenderer, &LayeredRenderer::onConstructed<T>>(this));
+        mScene.onDestroy<Drawable<T>>(ComponentBatchObserver::create<LayeredRenderer, &LayeredRenderer::onDestroyed<T>>(this));
     }
     
     template<typename T>
-    void removeNewComponentDelegate(){
-        mScene.removeDelegate<NewComponent<Drawable<T>>>(EventDelegate::create<LayeredRenderer, &LayeredRenderer::onNewLayeredComponent<T>>(this));
+    void removeObservers(){
+        mScene.removeOnConstruct<Drawable<T>>(ComponentBatchObserver::create<LayeredRenderer, &LayeredRenderer::onConstructed<T>>(this));
+        mScene.removeOnDestroy<Drawable<T>>(ComponentBatchObserver::create<LayeredRenderer, &LayeredRenderer::onDestroyed<T>>(this));
     }
     
-    template<typename T>
-    void insertIntoOrderedLayer(const std::string& layerName, float order, DrawableHandle<T> handle){
+    OrderedLayer& findLayer(const std::string& layerName){
         auto found = std::find_if(mLayers.begin(), mLayers.end(), [&layerName](const Layer& layer){
             return layer.name == layerName;
         });
         if(found != mLayers.end()){
-            //we have this layer, pull the typed list from the tuple at a given draw order
-            auto foundOrder = found->layer.find(order);
-            if(foundOrder != found->layer.end()){
-                auto& list = get_element_by_type<DrawableHandleList<T>>(foundOrder->second);
-                list.emplace_back(std::move(handle));
-            }else{
-                TypesList l{DrawableHandleList<DrawableTypes>(mScene.getAllocator<DrawableHandle<T>>())...};
-                auto& list = get_element_by_type<DrawableHandleList<T>>(l);
-                list.emplace_back(std::move(handle));
-                found->layer.emplace(order, std::move(l));
-            }
-            
-        }else{
-            //error and put it in default
-            auto& defaultLayer = *(std::find_if(mLayers.begin(), mLayers.end(), [](const Layer& layer){
-                return layer.name == "default";
-            }));
-            
-            auto foundOrder = defaultLayer.layer.find(order);
-            if(foundOrder != defaultLayer.layer.end()){
-                auto& list = get_element_by_type<DrawableHandleList<T>>(foundOrder->second);
-                list.emplace_back(std::move(handle));
-            }else{
-                TypesList l{DrawableHandleList<DrawableTypes>(mScene.getAllocator<DrawableHandle<T>>())...};
-                auto& list = get_element_by_type<DrawableHandleList<T>>(l);
-                list.emplace_back(std::move(handle));
-                defaultLayer.layer.emplace(order, std::move(l));
-            }
-            
-            MS_LOG_ERROR("Didnt have a rendering layer called: " + layerName + " placeing drawable in default layer.");
+            return found->layer;
         }
+        //error and put it in default
+        MS_LOG_ERROR("Didnt have a rendering layer called: " + layerName + " placeing drawable in default layer.");
+        return std::find_if(mLayers.begin(), mLayers.end(), [](const Layer& layer){
+            return layer.name == "default";
+        })->layer;
+    }
+    
+    //pulls the typed list from the tuple at a given draw order
+    template<typename T>
+    DrawableList<T>& getOrderedList(OrderedLayer& layer, float order){
+        auto found = layer.find(order);
+        if(found == layer.end()){
+            TypesList l{DrawableList<DrawableTypes>(mScene.getAllocator<DrawableId<DrawableTypes>>())...};
+            found = layer.emplace(order, std::move(l)).first;
+        }
+        return get_element_by_type<DrawableList<T>>(found->second);
+    }
+    
+    template<typename T>
+    void insertIntoOrderedLayer(const std::string& layerName, float order, size_t entity_id){
+        auto& layer = findLayer(layerName);
+        auto& list = getOrderedList<T>(layer, order);
+        list.emplace_back(DrawableId<T>{entity_id});
+        get_element_by_type<LocationMap<T>>(mLocations)[entity_id] = Location<T>{&layer, order, std::prev(list.end())};
     }
     
     template<typename T>
-    void checkOrder(const std::string& layer, float order, DrawableHandleList<T>& handles){
-        auto it = handles.begin();
-        auto end = handles.end();
+    void checkOrder(const std::string& layer, float order, DrawableList<T>& ids){
+        auto& components = get_element_by_type<ComponentMap<Drawable<T>>>(mComponents);
+        auto& locations = get_element_by_type<LocationMap<T>>(mLocations);
+        auto it = ids.begin();
+        auto end = ids.end();
         while( it != end ){
-            if(auto component = it->lock()){
-                if(component->getDrawOrder() != order || component->getLayer() != layer){
-                    it = handles.erase(it);
-                    insertIntoOrderedLayer<T>(component->getLayer(), component->getDrawOrder(), std::move(component));
-                }else{
+            auto component = components.get(it->entity_id);
+            if(component && (component->getDrawOrder() != order || component->getLayer() != layer)){
+                auto& targetLayer = findLayer(component->getLayer());
+                auto& list = getOrderedList<T>(targetLayer, component->getDrawOrder());
+                //a missing layer falls back to where it already is
+                if(&list == &ids){
                     ++it;
+                    continue;
                 }
+                //moves the node, the location keeps pointing at it
+                auto& location = locations[it->entity_id];
+                location.layer = &targetLayer;
+                location.order = component->getDrawOrder();
+                list.splice(list.end(), ids, it++);
             }else{
-                it = handles.erase(it);
+                ++it;
             }
         }
     }
     
     template<typename T>
-    void drawLayer(DrawableHandleList<T>& handles){
-        auto it = handles.begin();
-        auto end = handles.end();
-        while (it!=end) {
-            if (auto component = (*it).lock()) {
-                if (component->isVisible()) {
-                    auto model = component->getGlobalTransformMatrix();
-                    auto c = component->getColor();
-                    c.a *= mGlobalAlpha;
-                    ofSetColor(c);
-                    ofPushMatrix();
-                    ofMultMatrix(model);
-                    component->draw();
-                    ofPopMatrix();
+    void drawLayer(DrawableList<T>& ids, ComponentView<ofNode>& nodes){
+        auto& components = get_element_by_type<ComponentMap<Drawable<T>>>(mComponents);
+        auto transforms = mScene.getTransformSystem();
+        for(auto & entry : ids){
+            //null only if it was destroyed since the last flush, it's dropped at the next one
+            auto component = components.get(entry.entity_id);
+            if (component && component->isVisible()) {
+                auto id = entry.entity_id;
+                glm::mat4 model;
+                if(transforms && transforms->isCached(id)){
+                    model = transforms->getGlobalTransformMatrix(id);
+                }else if(nodes.contains(id)){
+                    model = nodes.get<ofNode>(id).getGlobalTransformMatrix();
                 }
-                ++it;
-            }
-            else {
-                it = handles.erase(it);
+                auto c = component->getColor();
+                c.a *= mGlobalAlpha;
+                ofSetColor(c);
+                ofPushMatrix();
+                ofMultMatrix(model);
+                component->draw();
+                ofPopMatrix();
             }
         }
     }
     
     template<typename T>
-    EventStatus onNewLayeredComponent( const IEventRef& event ){
-        auto cast = std::static_pointer_cast<NewComponent<Drawable<T>>>(event);
-        if(cast->getComponentType() == &type_id<Drawable<T>>){
-            auto compHandle = cast->getComponentHandle();
-            if(auto comp = compHandle.lock()){
-                auto layer = comp->getLayer();
-                auto order = comp->getDrawOrder();
-                insertIntoOrderedLayer<T>(layer, order, std::move(compHandle));
+    void onConstructed(const std::vector<size_t>& entity_ids){
+        auto& components = get_element_by_type<ComponentMap<Drawable<T>>>(mComponents);
+        auto& locations = get_element_by_type<LocationMap<T>>(mLocations);
+        for(auto entity_id : entity_ids){
+            if(locations.count(entity_id))
+                continue;
+            if(auto component = components.get(entity_id)){
+                insertIntoOrderedLayer<T>(component->getLayer(), component->getDrawOrder(), entity_id);
             }
-            return EventStatus::SUCCESS;
         }
-        MS_LOG_ERROR("Something is wrong, the type_ids should match on new component event!");
-        return EventStatus::FAILED;
+    }
+    
+    template<typename T>
+    void onDestroyed(const std::vector<size_t>& entity_ids){
+        auto& components = get_element_by_type<ComponentMap<Drawable<T>>>(mComponents);
+        auto& locations = get_element_by_type<LocationMap<T>>(mLocations);
+        for(auto entity_id : entity_ids){
+            //destroyed and created again in the same frame
+            if(components.get(entity_id))
+                continue;
+            auto found = locations.find(entity_id);
+            if(found == locations.end())
+                continue;
+            auto& location = found->second;
+            auto order = location.layer->find(location.order);
+            get_element_by_type<DrawableList<T>>(order->second).erase(location.it);
+            locations.erase(found);
+        }
     }
     
     EventStatus onDraw( const IEventRef& event ){
@@ -285,7 +342,9 @@ private:
     
     float mGlobalAlpha{1.f};
     Scene& mScene;
+    Components mComponents;
     LayerList mLayers;
+    Locations mLocations;
 };
     
 }//end namespace mediasystem
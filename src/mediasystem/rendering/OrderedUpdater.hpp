@@ -8,6 +8,7 @@
 #pragma once
 
 #include <tuple>
+#include <unordered_map>
 #include "ofMain.h"
 #include "mediasystem/core/Entity.h"
 #include "mediasystem/rendering/IPresenter.h"
@@ -31,9 +32,9 @@ namespace mediasystem {
         {}
     
         //orderable concept
-        void setUpdateOrder(float order) const { mOrder = order; }
+        void setUpdateOrder(float order) { mOrder = order; }
         float getUpdateOrder() const { return mOrder; }
-        float setUpdateEnabled(bool set) const { return mEnabled = set; }
+        void setUpdateEnabled(bool set) { mEnabled = set; }
         bool isUpdateEnabled()const{ return mEnabled; }
         
         //updateable concept
@@ -45,30 +46,49 @@ namespace mediasystem {
     };
     
     template<typename T>
-    using UpdateableHandle = Handle<Updateable<T>>;
+    using UpdateableHandle = ComponentHandle<Updateable<T>>;
     
+    //entities whose Updateable<T> sits at some update order, typed so every T gets its own list
     template<typename T>
-    using UpdateableHandleList = std::list<UpdateableHandle<T>,Allocator<UpdateableHandle<T>>>;
+    struct UpdateableId {
+        size_t entity_id;
+    };
+    
+    template<typename T>
+    using UpdateableList = std::list<UpdateableId<T>,Allocator<UpdateableId<T>>>;
     
+    //Entries are added and dropped by batched construct and destroy observers, which the scene
+    //flushes after its update, so the loops here only visit live components and never erase.
     template<typename...UpdateableTypes>
     class OrderedUpdater {
         
-        using OrderedList = std::tuple<UpdateableHandleList<UpdateableTypes>...>;
+        using OrderedList = std::tuple<UpdateableList<UpdateableTypes>...>;
         using OderedListsMap = std::map<float, OrderedList>;
         
+        template<typename T>
+        struct Location {
+            float order;
+            typename UpdateableList<T>::iterator it;
+        };
+        template<typename T>
+        using LocationMap = std::unordered_map<size_t, Location<T>>;
+        using Locations = std::tuple<LocationMap<UpdateableTypes>...>;
+        using Components = std::tuple<ComponentMap<Updateable<UpdateableTypes>>...>;
+        
     public:
         
         OrderedUpdater(Scene& scene):
-        mScene(scene)
+        mScene(scene),
+        mComponents(scene.getComponents<Updateable<UpdateableTypes>>()...)
         {
-            mScene.addDelegate<Update>(EventDelegate::create<OrderedUpdater,&OrderedUpdater::onUpdate>(this));
-            int l[] = {(addNewComponentDelegate<UpdateableTypes>(),0)...};
+            mScene.addDelegate<Update>(EventDelegate::create<OrderedUpdater,&OrderedUpdater::onUpdate>(this), "OrderedUpdater");
+            int l[] = {(addObservers<UpdateableTypes>(),0)...};
             UNUSED_VARIABLE(l);
         }
         
         ~OrderedUpdater(){
             mScene.removeDelegate<Update>(EventDelegate::create<OrderedUpdater,&OrderedUpdater::onUpdate>(this));
-            int l[] = {(removeNewComponentDelegate<UpdateableTypes>(),0)...};
+            int l[] = {(removeObservers<UpdateableTypes>(),0)...};
             UNUSED_VARIABLE(l);
         }
     
@@ -105,77 +125,95 @@ namespace mediasystem {
         };
         
         template<typename T>
-        void addNewComponentDelegate(){
-            mScene.addDelegate<NewComponent<Updateable<T>>>(EventDelegate::create<OrderedUpdater, &OrderedUpdater::onNewOrderedComponent<T>>(this));
+        void addObservers(){
+            mScene.onConstruct<Updateable<T>>(ComponentBatchObserver::create<OrderedUpdater, &OrderedUpdater::onConstructed<T>>(this));
+            mScene.onDestroy<Updateable<T>>(ComponentBatchObserver::create<OrderedUpdater, &OrderedUpdater::onDestroyed<T>>(this));
         }
         
         template<typename T>
-        void removeNewComponentDelegate(){
-            mScene.removeDelegate<NewComponent<Updateable<T>>>(EventDelegate::create<OrderedUpdater, &OrderedUpdater::onNewOrderedComponent<T>>(this));
+        void removeObservers(){
+            mScene.removeOnConstruct<Updateable<T>>(ComponentBatchObserver::create<OrderedUpdater, &OrderedUpdater::onConstructed<T>>(this));
+            mScene.removeOnDestroy<Updateable<T>>(ComponentBatchObserver::create<OrderedUpdater, &OrderedUpdater::onDestroyed<T>>(this));
         }
         
         template<typename T>
-        void insertIntoOrderedList(float order, UpdateableHandle<T> handle){
+        UpdateableList<T>& getOrderedList(float order){
             auto found = mOrderedLists.find(order);
-            if(found != mOrderedLists.end()){
-                auto& list = get_element_by_type<UpdateableHandleList<T>>(found->second);
-                list.emplace_back(std::move(handle));
-            }else{
-                OrderedList l{mScene.getAllocator<UpdateableHandleList<UpdateableTypes>>()...};
-                auto& list = get_element_by_type<UpdateableHandleList<T>>(l);
-                list.emplace_back(std::move(handle));
-                mOrderedLists.emplace(order, std::move(l));
+            if(found == mOrderedLists.end()){
+                OrderedList l{UpdateableList<UpdateableTypes>(mScene.getAllocator<UpdateableId<UpdateableTypes>>())...};
+                found = mOrderedLists.emplace(order, std::move(l)).first;
             }
+            return get_element_by_type<UpdateableList<T>>(found->second);
+        }
+        
+        template<typename T>
+        void insertIntoOrderedList(float order, size_t entity_id){
+            auto& list = getOrderedList<T>(order);
+            list.emplace_back(UpdateableId<T>{entity_id});
+            get_element_by_type<LocationMap<T>>(mLocations)[entity_id] = Location<T>{order, std::prev(list.end())};
         }
         
         template<typename T>
-        void checkOrder(float order, UpdateableHandleList<T>& handles){
-            auto it = handles.begin();
-            auto end = handles.end();
+        void checkOrder(float order, UpdateableList<T>& ids){
+            auto& components = get_element_by_type<ComponentMap<Updateable<T>>>(mComponents);
+            auto& locations = get_element_by_type<LocationMap<T>>(mLocations);
+            auto it = ids.begin();
+            auto end = ids.end();
             while( it != end ){
-                if(auto component = it->lock()){
-                    if(component->getLayer() != order){
-                        it = handles.erase(it);
-                        insertIntoOrderedList<T>(component->getUpdateOrder(), std::move(component));
-                    }else{
-                        ++it;
-                    }
+                auto component = components.get(it->entity_id);
+                if(component && component->getUpdateOrder() != order){
+                    //moves the node, the location keeps pointing at it
+                    auto newOrder = component->getUpdateOrder();
+                    auto& location = locations[it->entity_id];
+                    location.order = newOrder;
+                    auto& list = getOrderedList<T>(newOrder);
+                    list.splice(list.end(), ids, it++);
                 }else{
-                    it = handles.erase(it);
+                    ++it;
                 }
             }
         }
         
         template<typename T>
-        void updateOrderedList(UpdateableHandleList<T>& handles){
-            auto it = handles.begin();
-            auto end = handles.end();
-            while (it!=end) {
-                if (auto component = (*it).lock()) {
-                    if (component->isUpdateEnabled()) {
-                        component->update();
-                    }
-                    ++it;
-                }
-                else {
-                    it = handles.erase(it);
+        void updateOrderedList(UpdateableList<T>& ids){
+            auto& components = get_element_by_type<ComponentMap<Updateable<T>>>(mComponents);
+            for(auto & id : ids){
+                //null only if it was destroyed earlier in this update, it's dropped at the next flush
+                auto component = components.get(id.entity_id);
+                if (component && component->isUpdateEnabled()) {
+                    component->update();
                 }
             }
         }
         
         template<typename T>
-        EventStatus onNewOrderedComponent( const IEventRef& event ){
-            auto cast = std::static_pointer_cast<NewComponent<Updateable<T>>>(event);
-            if(cast->getComponentType() == &type_id<Updateable<T>>){
-                auto compHandle = cast->getComponentHandle();
-                if(auto comp = compHandle.lock()){
-                    auto order = comp->getUpdateOrder();
-                    insertIntoOrderedList<T>(order, std::move(compHandle));
+        void onConstructed(const std::vector<size_t>& entity_ids){
+            auto& components = get_element_by_type<ComponentMap<Updateable<T>>>(mComponents);
+            auto& locations = get_element_by_type<LocationMap<T>>(mLocations);
+            for(auto entity_id : entity_ids){
+                if(locations.count(entity_id))
+                    continue;
+                if(auto component = components.get(entity_id)){
+                    insertIntoOrderedList<T>(component->getUpdateOrder(), entity_id);
                 }
-                return EventStatus::SUCCESS;
             }
-            MS_LOG_ERROR("Something is wrong, the type_ids should match on new component event!");
-            return EventStatus::FAILED;
+        }
+        
+        template<typename T>
+        void onDestroyed(const std::vector<size_t>& entity_ids){
+            auto& components = get_element_by_type<ComponentMap<Updateable<T>>>(mComponents);
+            auto& locations = get_element_by_type<LocationMap<T>>(mLocations);
+            for(auto entity_id : entity_ids){
+                //destroyed and created again in the same frame
+                if(components.get(entity_id))
+                    continue;
+                auto found = locations.find(entity_id);
+                if(found == locations.end())
+                    continue;
+                auto order = mOrderedLists.find(found->second.order);
+                get_element_by_type<UpdateableList<T>>(order->second).erase(found->second.it);
+                locations.erase(found);
+            }
         }
         
         EventStatus onUpdate( const IEventRef& event ){
@@ -184,7 +222,8 @@ namespace mediasystem {
         }
         
         Scene& mScene;
+        Components mComponents;
         OderedListsMap mOrderedLists;
+        Locations mLocations;
     };
 }//end namespace
-
@@ -0,0 +1,149 @@
+//
+//  ThreadPool.hpp
+//  ofxMediaSystem
+//
+
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <thread>
+#include <functional>
+#include <algorithm>
+#include <condition_variable>
+
+namespace mediasystem {
+
+    //Fixed set of worker threads fed from a single queue. Meant for short bursts of
+    //data parallel work inside a frame, not for long running jobs.
+    class ThreadPool {
+    public:
+
+        //0 starts one worker per hardware thread, minus the thread that calls parallelFor
+        explicit ThreadPool(size_t numWorkers = 0)
+        {
+            if(numWorkers == 0){
+                auto hardware = std::thread::hardware_concurrency();
+                numWorkers = hardware > 1 ? hardware - 1 : 1;
+            }
+            mWorkers.reserve(numWorkers);
+            for(size_t i = 0; i < numWorkers; ++i){
+                mWorkers.emplace_back(&ThreadPool::workerLoop, this);
+            }
+        }
+
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mStop = true;
+            }
+            mCondition.notify_all();
+            for(auto & worker : mWorkers){
+                worker.join();
+            }
+        }
+
+        //non copyable
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        inline size_t getNumWorkers() const { return mWorkers.size(); }
+        //threads a parallelFor is spread over, the caller takes part
+        inline size_t getConcurrency() const { return mWorkers.size() + 1; }
+
+        void submit(std::function<void()> task)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mTasks.emplace_back(std::move(task));
+            }
+            mCondition.notify_one();
+        }
+
+        //Calls fn(i) for every i in [0, count) and returns once all of them are done. Indices are
+        //handed out one at a time so uneven items balance themselves. The calling thread works too,
+        //so it is safe to nest inside a task even when every worker is busy.
+        template<typename Fn>
+        void parallelFor(size_t count, Fn&& fn)
+        {
+            if(count == 0)
+                return;
+            if(count == 1 || mWorkers.empty()){
+                for(size_t i = 0; i < count; ++i){
+                    fn(i);
+                }
+                return;
+            }
+
+            //helpers that start after everything is claimed never touch fn, so it can stay on the caller's stack
+            auto batch = std::make_shared<Batch>();
+            auto task = [batch, count, &fn](){
+                size_t completed = 0;
+                size_t i;
+                while((i = batch->next.fetch_add(1)) < count){
+                    fn(i);
+                    ++completed;
+                }
+                if(completed && batch->done.fetch_add(completed) + completed == count){
+                    std::lock_guard<std::mutex> lock(batch->mutex);
+                    batch->finished.notify_all();
+                }
+            };
+
+            auto helpers = std::min(count - 1, mWorkers.size());
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                for(size_t i = 0; i < helpers; ++i){
+                    mTasks.emplace_back(task);
+                }
+            }
+            if(helpers == mWorkers.size()){
+                mCondition.notify_all();
+            }else{
+                for(size_t i = 0; i < helpers; ++i){
+                    mCondition.notify_one();
+                }
+            }
+
+            task();
+            std::unique_lock<std::mutex> lock(batch->mutex);
+            batch->finished.wait(lock, [&](){ return batch->done.load() == count; });
+        }
+
+    private:
+
+        struct Batch {
+            std::atomic<size_t> next{0};
+            std::atomic<size_t> done{0};
+            std::mutex mutex;
+            std::condition_variable finished;
+        };
+
+        void workerLoop()
+        {
+            while(true){
+                std::function<void()> task;
+                {
+                    std::unique_lock<std::mutex> lock(mMutex);
+                    mCondition.wait(lock, [&](){ return mStop || !mTasks.empty(); });
+                    if(mStop && mTasks.empty())
+                        return;
+                    task = std::move(mTasks.front());
+                    mTasks.pop_front();
+                }
+                task();
+            }
+        }
+
+        std::vector<std::thread> mWorkers;
+        std::deque<std::function<void()>> mTasks;
+        std::mutex mMutex;
+        std::condition_variable mCondition;
+        bool mStop{false};
+    };
+
+}//end namespace mediasystem
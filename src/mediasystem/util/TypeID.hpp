@@ -7,11 +7,96 @@
 
 #pragma once
 #include <memory>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <limits>
+#include <unordered_map>
 
 namespace mediasystem {
-    
+
     template<typename>
     void type_id(){}
     using type_id_t = void(*)();
-    
+
+    //dense index per type, handed out in order of first use, stable for the life of the program
+    using type_index_t = size_t;
+    constexpr type_index_t INVALID_TYPE_INDEX = std::numeric_limits<type_index_t>::max();
+
+    namespace detail {
+
+        //Reverse lookups read an immutable snapshot without locking. Adding a type copies the snapshot
+        //under the lock and publishes the copy, which happens once per type. Replaced snapshots are kept
+        //since a reader may still be using one.
+        class type_index_registry {
+        public:
+
+            static type_index_t add(type_id_t type){
+                auto& registry = get();
+                std::lock_guard<std::mutex> lock(registry.mMutex);
+                auto current = registry.mCurrent.load(std::memory_order_relaxed);
+                auto found = current->indices.find(type);
+                if(found != current->indices.end())
+                    return found->second;
+                auto index = current->types.size();
+                registry.mSnapshots.emplace_back(new Snapshot(*current));
+                auto& next = *registry.mSnapshots.back();
+                next.types.push_back(type);
+                next.indices.emplace(type, index);
+                registry.mCurrent.store(&next, std::memory_order_release);
+                return index;
+            }
+
+            static type_id_t getType(type_index_t index){
+                auto& types = get().mCurrent.load(std::memory_order_acquire)->types;
+                return index < types.size() ? types[index] : nullptr;
+            }
+
+            static type_index_t getIndex(type_id_t type){
+                auto& indices = get().mCurrent.load(std::memory_order_acquire)->indices;
+                auto found = indices.find(type);
+                return found != indices.end() ? found->second : INVALID_TYPE_INDEX;
+            }
+
+            static size_t size(){
+                return get().mCurrent.load(std::memory_order_acquire)->types.size();
+            }
+
+        private:
+
+            struct Snapshot {
+                std::vector<type_id_t> types;
+                std::unordered_map<type_id_t, type_index_t> indices;
+            };
+
+            type_index_registry(){
+                mSnapshots.emplace_back(new Snapshot());
+                mCurrent.store(mSnapshots.back().get(), std::memory_order_release);
+            }
+
+            static type_index_registry& get(){
+                static type_index_registry sRegistry;
+                return sRegistry;
+            }
+
+            std::mutex mMutex;
+            std::atomic<const Snapshot*> mCurrent{nullptr};
+            std::vector<std::unique_ptr<Snapshot>> mSnapshots; //every snapshot published, the last is current
+        };
+
+    }//end namespace detail
+
+    //O(1) after the first call for a given type
+    template<typename T>
+    inline type_index_t type_index(){
+        static const type_index_t sIndex = detail::type_index_registry::add(type_id<T>);
+        return sIndex;
+    }
+
+    //reverse lookups, nullptr / INVALID_TYPE_INDEX for types that have never asked for an index. Lock free,
+    //type_index_from_id is still a hash lookup so hot paths should use the type_index<T>() overloads.
+    inline type_id_t type_from_index(type_index_t index){ return detail::type_index_registry::getType(index); }
+    inline type_index_t type_index_from_id(type_id_t type){ return detail::type_index_registry::getIndex(type); }
+    inline size_t type_index_count(){ return detail::type_index_registry::size(); }
+
 }//end namespace media system